@@ -7,8 +7,17 @@
 
 #pragma once
 
+#include <cmath>
+
 #include <boost/numeric/ublas/matrix.hpp>
 
+// SSE が使えるなら KBLAS_USE_SSE を定義する ( float の 4x4 の逆行列や Givens 回転で使う )
+// KBLAS_NO_SSE を定義すると使わない
+#if !defined(KBLAS_NO_SSE) && ( defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1) )
+#define KBLAS_USE_SSE
+#include <xmmintrin.h>
+#endif
+
 namespace kblas {
 
 // ベクトルクラス 
@@ -19,6 +28,13 @@ class KVec {
 public:
     static const int SIZE = N;
 public:
+
+    KVec() {}
+
+    KVec(const T&v ) {
+        for( int i=0; i<N; ++i ) m_v[i] = v;
+    }
+
     T & operator()(int i) {
         return m_v[i];
     }
@@ -105,7 +121,8 @@ public:
 			(*this)(i,j) = mat(i,j);
 	}
 
-    KMat( const KMatTrans<T,N,M> &m1 ) {
+    /// 転置行列 ( M x N ) を転置したもの
+    KMat( const KMatTrans<T,M,N> &m1 ) {
         for( int i=0; i<N; ++i ) for( int j=0; j<M; ++j ) {
             (*this)(i,j) = m1(j,i);
         }
@@ -118,6 +135,14 @@ public:
         return m_v[i*M+j];
     }
 
+    /// 行優先の生データ
+    T * Data() {
+        return m_v;
+    }
+    const T * Data() const {
+        return m_v;
+    }
+
 	KMat & operator +=( const KMat<T,N,M> &m1 ) {
 
         Detail::AddMM<T,N,M>::f(*this, m1);
@@ -151,7 +176,7 @@ public:
         for(int i=0; i<N*M; ++i) m_v[i] = m.m_v[i];
     }
     KMatTrans( KMat<T,M,N> &&m ) {
-        m_v = std::move(m.m_v);
+        for(int i=0; i<N*M; ++i) m_v[i] = m.m_v[i];
     }
 
     T & operator()(int i, int j) {
@@ -187,7 +212,7 @@ namespace Detail {
     // かけ算クラス
     template<class T, int M, int N, int j>
     struct MultL {
-        static void f( KVec<T,N> &vr, const KMat<T,M,N> &m1, const KVec<T,N> &v1 ) {
+        static void f( KVec<T,M> &vr, const KMat<T,M,N> &m1, const KVec<T,N> &v1 ) {
             vr(j) = MultL1<T, M, N, j, N-1>::f( m1, v1 );
             MultL<T,M,N,j-1>::f( vr, m1, v1 );
         }
@@ -195,7 +220,7 @@ namespace Detail {
 
     template<class T, int M, int N>
     struct MultL<T, M, N, -1> {
-        static void f( KVec<T,N> &vr, const KMat<T,M,N> &m1, const KVec<T,N> &v1 ) {
+        static void f( KVec<T,M> &vr, const KMat<T,M,N> &m1, const KVec<T,N> &v1 ) {
         }
     };
 
@@ -221,7 +246,7 @@ namespace Detail {
         // かけ算クラス
         template<class T, int M, int N, int j>
         struct MultL {
-            static void f( KVec<T,N> &vr, const KMatTrans<T,M,N> &m1, const KVec<T,N> &v1 ) {
+            static void f( KVec<T,M> &vr, const KMatTrans<T,M,N> &m1, const KVec<T,N> &v1 ) {
                 vr(j) = MultL1<T, M, N, j, N-1>::f( m1, v1 );
                 MultL<T,M,N,j-1>::f( vr, m1, v1 );
             }
@@ -229,7 +254,7 @@ namespace Detail {
 
         template<class T, int M, int N>
         struct MultL<T, M, N, -1> {
-            static void f( KVec<T,N> &vr, const KMatTrans<T,M,N> &m1, const KVec<T,N> &v1 ) {
+            static void f( KVec<T,M> &vr, const KMatTrans<T,M,N> &m1, const KVec<T,N> &v1 ) {
             }
         };
     }
@@ -272,14 +297,14 @@ namespace Detail {
     namespace VMt {
         template<class T, int M, int N, int j, int i>
         struct MultR1 {
-            static T f( const KVec<T,M> &v1, const KMat<T,M,N> &m1 ) {
+            static T f( const KVec<T,M> &v1, const KMatTrans<T,M,N> &m1 ) {
                 return MultR1<T, M, N, j, i-1>::f( v1, m1 ) + v1(i) * m1(i, j);
             }
         };
 
         template<class T, int M, int N, int j>
         struct MultR1<T, M, N, j, -1> {
-            static T f( const KVec<T,M> &v1, const KMat<T,M,N> &m1 ) {
+            static T f( const KVec<T,M> &v1, const KMatTrans<T,M,N> &m1 ) {
                 return T();
             }
         };
@@ -287,7 +312,7 @@ namespace Detail {
         // かけ算クラス
         template<class T, int M, int N, int j>
         struct MultR {
-            static void f( KVec<T,N> &vr, const KVec<T,M> &v1, const KMat<T,M,N> &m1 ) {
+            static void f( KVec<T,N> &vr, const KVec<T,M> &v1, const KMatTrans<T,M,N> &m1 ) {
                 vr(j) = MultR1<T, M, N, j, M-1>::f( v1, m1 );
                 MultR<T,M,N,j-1>::f( vr, v1, m1 );
             }
@@ -295,7 +320,7 @@ namespace Detail {
 
         template<class T, int M, int N>
         struct MultR<T, M, N, -1> {
-            static void f( KVec<T,N> &vr, const KVec<T,M> &v1, const KMat<T,M,N> &m1 ) {
+            static void f( KVec<T,N> &vr, const KVec<T,M> &v1, const KMatTrans<T,M,N> &m1 ) {
             }
         };
     }
@@ -501,8 +526,8 @@ namespace Detail {
 ///////////////////////////////////////////////////////////////////////////////////
 // M V の積
 template<class T, int M, int N>
-KVec<T, N>   prod( const KMat<T, M, N > &m1, const KVec<T,N> &v1 ) { 
-    KVec<T,N> rv;
+KVec<T, M>   prod( const KMat<T, M, N > &m1, const KVec<T,N> &v1 ) { 
+    KVec<T,M> rv;
     Detail::MultL<T, M, N, M-1>::f(rv, m1, v1);
     return rv;
 }
@@ -510,8 +535,8 @@ KVec<T, N>   prod( const KMat<T, M, N > &m1, const KVec<T,N> &v1 ) {
 ///////////////////////////////////////////////////////////////////////////////////
 // Mt V の積
 template<class T, int M, int N>
-KVec<T, N>   prod( const KMatTrans<T, M, N > &m1, const KVec<T,N> &v1 ) { 
-    KVec<T,N> rv;
+KVec<T, M>   prod( const KMatTrans<T, M, N > &m1, const KVec<T,N> &v1 ) { 
+    KVec<T,M> rv;
     Detail::MtV::MultL<T, M, N, M-1>::f(rv, m1, v1);
     return rv;
 }
@@ -633,6 +658,29 @@ struct MultRC<T,M,N,-1> {
 
 }; // namepsace Detail
 
+namespace Detail {
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 1 ノルム ( 列の絶対値の和の最大 )
+    template<class T, int M, int N>
+    T Norm1( const KMat<T,M,N> &a ) {
+        T r = T();
+        for( int j=0; j<N; ++j ) {
+            T s = T();
+            for( int i=0; i<M; ++i ) s += std::abs(a(i,j));
+            if( s > r ) r = s;
+        }
+        return r;
+    }
+
+    template<class T, int N>
+    T Norm1( const KVec<T,N> &v ) {
+        T r = T();
+        for( int i=0; i<N; ++i ) r += std::abs(v(i));
+        return r;
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////////////
 // operator * (M, C)
 template<class T,int M, int N>
@@ -0,0 +1,437 @@
+﻿/////////////////////////////////////////////////////////////////////////////
+/** @file
+    @brief  対角行列・帯行列 ( 対角を KVec で持つ ) と三重対角の解法
+    @author oniprog
+*/
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cassert>
+
+#include "KMat.h"
+#include "KMatBatch.h"
+
+namespace kblas {
+
+// 帯行列
+// T 型
+// N サイズ
+// Lo 下側の帯幅 ( 対角より下の本数 )
+// Hi 上側の帯幅
+// 対角 off ( -Lo .. Hi ) を KVec<T,N> に持ち，要素 (i,i+off) はその i 番目に入る
+// 帯の外に出る端の要素は使わない
+template<class T, int N, int Lo, int Hi>
+class KBandMat {
+public:
+    static const int SIZE = N;
+    static const int BAND_LO = Lo;
+    static const int BAND_HI = Hi;
+public:
+
+    KBandMat() {}
+
+    /// 帯の中の要素をすべて v にする
+    KBandMat( const T &v ) {
+        for( int k=0; k<Lo+Hi+1; ++k ) m_d[k] = KVec<T,N>(v);
+    }
+
+    /// 帯の外は 0
+    const T operator()(int i, int j) const {
+        return IsInside(i,j) ? m_d[j-i+Lo](i) : T();
+    }
+
+    /// 書き込み用．(i,j) は帯の中 ( -Lo <= j-i <= Hi ) であること
+    T & Ref( int i, int j ) {
+        assert( IsInside(i,j) );
+        return m_d[j-i+Lo](i);
+    }
+
+    /// 対角 off ( 0 が主対角，正が上 )．要素 i は (i,i+off)
+    KVec<T,N> & Diag( int off ) {
+        return m_d[off+Lo];
+    }
+    const KVec<T,N> & Diag( int off ) const {
+        return m_d[off+Lo];
+    }
+
+    /// 密な行列にする
+    KMat<T,N,N> Dense() const {
+        KMat<T,N,N> m(T(0));
+        for( int i=0; i<N; ++i ) {
+            const int j0 = i - Lo > 0 ? i - Lo : 0;
+            const int j1 = i + Hi < N-1 ? i + Hi : N-1;
+            for( int j=j0; j<=j1; ++j ) m(i,j) = m_d[j-i+Lo](i);
+        }
+        return m;
+    }
+
+    static bool IsInside( int i, int j ) {
+        return j - i >= -Lo && j - i <= Hi;
+    }
+
+private:
+    KVec<T,N>   m_d[Lo+Hi+1];
+};
+
+// 帯行列の束 ( 対角ごとに KVecBatch で持つので，各要素が B 個連続して並ぶ )
+template<class T, int N, int Lo, int Hi, int B>
+class KBandMatBatch {
+public:
+    static const int SIZE = N;
+    static const int BAND_LO = Lo;
+    static const int BAND_HI = Hi;
+    static const int BATCH = B;
+public:
+
+    KBandMatBatch() {}
+
+    KBandMatBatch( const T &v ) {
+        for( int k=0; k<Lo+Hi+1; ++k ) m_d[k] = KVecBatch<T,N,B>(v);
+    }
+
+    /// 帯の外は 0
+    const T operator()(int i, int j, int b) const {
+        return KBandMat<T,N,Lo,Hi>::IsInside(i,j) ? m_d[j-i+Lo](i,b) : T();
+    }
+
+    /// 書き込み用．(i,j) は帯の中であること
+    T & Ref( int i, int j, int b ) {
+        assert( (KBandMat<T,N,Lo,Hi>::IsInside(i,j)) );
+        return m_d[j-i+Lo](i,b);
+    }
+
+    KVecBatch<T,N,B> & Diag( int off ) {
+        return m_d[off+Lo];
+    }
+    const KVecBatch<T,N,B> & Diag( int off ) const {
+        return m_d[off+Lo];
+    }
+
+    /// b 番目に帯行列を入れる
+    void Set( int b, const KBandMat<T,N,Lo,Hi> &m ) {
+        for( int k=0; k<Lo+Hi+1; ++k ) m_d[k].Set( b, m.Diag(k-Lo) );
+    }
+
+    KBandMat<T,N,Lo,Hi> Get( int b ) const {
+        KBandMat<T,N,Lo,Hi> m;
+        for( int k=0; k<Lo+Hi+1; ++k ) m.Diag(k-Lo) = m_d[k].Get(b);
+        return m;
+    }
+
+private:
+    KVecBatch<T,N,B>    m_d[Lo+Hi+1];
+};
+
+// 対角行列
+// 対角だけを KVec で持つ．積は O(N) / O(N K) で済む
+template<class T, int N>
+class KDiagMat {
+public:
+    static const int SIZE = N;
+public:
+
+    KDiagMat() {}
+
+    KDiagMat( const T &v ) : m_d(v) {}
+
+    explicit KDiagMat( const KVec<T,N> &d ) : m_d(d) {}
+
+    /// 対角の i 番目
+    T & operator()(int i) {
+        return m_d(i);
+    }
+    const T operator()(int i) const {
+        return m_d(i);
+    }
+    /// 対角の外は 0
+    const T operator()(int i, int j) const {
+        return i == j ? m_d(i) : T();
+    }
+
+    KVec<T,N> & Diag() {
+        return m_d;
+    }
+    const KVec<T,N> & Diag() const {
+        return m_d;
+    }
+
+    /// 密な行列にする
+    KMat<T,N,N> Dense() const {
+        KMat<T,N,N> m(T(0));
+        for( int i=0; i<N; ++i ) m(i,i) = m_d(i);
+        return m;
+    }
+
+private:
+    KVec<T,N>   m_d;
+};
+
+namespace Detail {
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 帯行列の積．対角ごとに 0 でない範囲だけを回す
+    // MB は (i,j) で要素を返すもの ( KMat, KMatTrans )
+    // r = A B ( A は N x N の帯，B は N x K )
+    template<class T, int N, int Lo, int Hi, int K, class MB>
+    void BandLeft( KMat<T,N,K> &r, const KBandMat<T,N,Lo,Hi> &a, const MB &b ) {
+        r = KMat<T,N,K>(T(0));
+        for( int off=-Lo; off<=Hi; ++off ) {
+            const KVec<T,N> &d = a.Diag(off);
+            const int i0 = off < 0 ? -off : 0;
+            const int i1 = off > 0 ? N - off : N;
+            for( int i=i0; i<i1; ++i ) {
+                const T di = d(i);
+                for( int k=0; k<K; ++k ) r(i,k) += di * b(i+off,k);
+            }
+        }
+    }
+
+    // r = B A ( B は M x N，A は N x N の帯 )
+    template<class T, int M, int N, int Lo, int Hi, class MB>
+    void BandRight( KMat<T,M,N> &r, const MB &b, const KBandMat<T,N,Lo,Hi> &a ) {
+        r = KMat<T,M,N>(T(0));
+        for( int off=-Lo; off<=Hi; ++off ) {
+            const KVec<T,N> &d = a.Diag(off);
+            const int i0 = off < 0 ? -off : 0;
+            const int i1 = off > 0 ? N - off : N;
+            for( int m=0; m<M; ++m ) {
+                for( int i=i0; i<i1; ++i ) r(m,i+off) += b(m,i) * d(i);
+            }
+        }
+    }
+
+    // r = D B ( D は対角 )
+    template<class T, int N, int K, class MB>
+    void DiagLeft( KMat<T,N,K> &r, const KDiagMat<T,N> &a, const MB &b ) {
+        for( int i=0; i<N; ++i ) {
+            const T di = a(i);
+            for( int k=0; k<K; ++k ) r(i,k) = di * b(i,k);
+        }
+    }
+
+    // r = B D
+    template<class T, int M, int N, class MB>
+    void DiagRight( KMat<T,M,N> &r, const MB &b, const KDiagMat<T,N> &a ) {
+        for( int m=0; m<M; ++m ) for( int j=0; j<N; ++j ) r(m,j) = b(m,j) * a(j);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 帯行列で A x = b を解く ( x は b を上書き，O(N Lo Hi) )
+/// ピボット選択をしないので，対角優位などピボットが 0 にならない行列に使う
+/// ピボットが 0 になったら x には触らずに false を返す
+template<class T, int N, int Lo, int Hi>
+bool band_solve( const KBandMat<T,N,Lo,Hi> &a, KVec<T,N> &x ) {
+    KBandMat<T,N,Lo,Hi> u(a);
+    KVec<T,N> y(x);
+    for( int k=0; k<N; ++k ) {
+        const T p = u(k,k);
+        if( p == T() ) return false;
+        const T ip = T(1) / p;
+        const int i1 = k + Lo < N-1 ? k + Lo : N-1;
+        const int j1 = k + Hi < N-1 ? k + Hi : N-1;
+        for( int i=k+1; i<=i1; ++i ) {
+            const T l = u(i,k) * ip;
+            for( int j=k+1; j<=j1; ++j ) u.Ref(i,j) -= l * u(k,j);
+            y(i) -= l * y(k);
+        }
+    }
+    for( int i=N-1; i>=0; --i ) {
+        const int j1 = i + Hi < N-1 ? i + Hi : N-1;
+        T s = y(i);
+        for( int j=i+1; j<=j1; ++j ) s -= u(i,j) * y(j);
+        y(i) = s / u(i,i);
+    }
+    x = y;
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 三重対角で A x = b を解く ( Thomas 法，x は b を上書き，O(N) )
+/// ピボット選択をしない．ピボットが 0 になったら x には触らずに false を返す
+template<class T, int N>
+bool solve_tridiag( const KBandMat<T,N,1,1> &a, KVec<T,N> &x ) {
+    const KVec<T,N> &lo = a.Diag(-1);
+    const KVec<T,N> &d  = a.Diag(0);
+    const KVec<T,N> &up = a.Diag(1);
+
+    T c[N];
+    KVec<T,N> y;
+    if( d(0) == T() ) return false;
+    T m = T(1) / d(0);
+    c[0] = up(0) * m;
+    y(0) = x(0) * m;
+    for( int i=1; i<N; ++i ) {
+        const T den = d(i) - lo(i) * c[i-1];
+        if( den == T() ) return false;
+        m = T(1) / den;
+        c[i] = up(i) * m;
+        y(i) = (x(i) - lo(i) * y(i-1)) * m;
+    }
+    for( int i=N-2; i>=0; --i ) y(i) -= c[i] * y(i+1);
+    x = y;
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 三重対角の束をまとめて解く ( Thomas 法 )
+/// 束の方向が一番内側で分岐がないので，独立な系をまたいでベクトル化される
+/// ピボットは確かめない ( 0 になった系の解は inf / NaN になる )
+template<class T, int N, int B>
+void solve_tridiag_batch( const KBandMatBatch<T,N,1,1,B> &a, KVecBatch<T,N,B> &x ) {
+    T c[N][B];
+    {
+        const T *d0 = a.Diag(0).Lane(0);
+        const T *u0 = a.Diag(1).Lane(0);
+        T *x0 = x.Lane(0);
+        for( int b=0; b<B; ++b ) {
+            const T m = T(1) / d0[b];
+            c[0][b] = u0[b] * m;
+            x0[b] *= m;
+        }
+    }
+    for( int i=1; i<N; ++i ) {
+        const T *li = a.Diag(-1).Lane(i);
+        const T *di = a.Diag(0).Lane(i);
+        const T *ui = a.Diag(1).Lane(i);
+        const T *xp = x.Lane(i-1);
+        T *xi = x.Lane(i);
+        for( int b=0; b<B; ++b ) {
+            const T m = T(1) / (di[b] - li[b] * c[i-1][b]);
+            c[i][b] = ui[b] * m;
+            xi[b] = (xi[b] - li[b] * xp[b]) * m;
+        }
+    }
+    for( int i=N-2; i>=0; --i ) {
+        const T *xn = x.Lane(i+1);
+        T *xi = x.Lane(i);
+        for( int b=0; b<B; ++b ) xi[b] -= c[i][b] * xn[b];
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// 対角行列の積 ( 対角の外は計算しない )
+template<class T, int N>
+KVec<T,N> prod( const KDiagMat<T,N> &a, const KVec<T,N> &v ) {
+    KVec<T,N> r;
+    for( int i=0; i<N; ++i ) r(i) = a(i) * v(i);
+    return r;
+}
+
+template<class T, int N>
+KVec<T,N> prod( const KVec<T,N> &v, const KDiagMat<T,N> &a ) {
+    return prod(a, v);
+}
+
+template<class T, int N>
+KDiagMat<T,N> prod( const KDiagMat<T,N> &a, const KDiagMat<T,N> &b ) {
+    KDiagMat<T,N> r;
+    for( int i=0; i<N; ++i ) r(i) = a(i) * b(i);
+    return r;
+}
+
+template<class T, int N, int K>
+KMat<T,N,K> prod( const KDiagMat<T,N> &a, const KMat<T,N,K> &b ) {
+    KMat<T,N,K> r;
+    Detail::DiagLeft(r, a, b);
+    return r;
+}
+
+template<class T, int N, int K>
+KMat<T,N,K> prod( const KDiagMat<T,N> &a, const KMatTrans<T,N,K> &b ) {
+    KMat<T,N,K> r;
+    Detail::DiagLeft(r, a, b);
+    return r;
+}
+
+template<class T, int M, int N>
+KMat<T,M,N> prod( const KMat<T,M,N> &b, const KDiagMat<T,N> &a ) {
+    KMat<T,M,N> r;
+    Detail::DiagRight(r, b, a);
+    return r;
+}
+
+template<class T, int M, int N>
+KMat<T,M,N> prod( const KMatTrans<T,M,N> &b, const KDiagMat<T,N> &a ) {
+    KMat<T,M,N> r;
+    Detail::DiagRight(r, b, a);
+    return r;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// 帯行列の積 ( O(N (Lo+Hi+1)) / O(N K (Lo+Hi+1)) )
+template<class T, int N, int Lo, int Hi>
+KVec<T,N> prod( const KBandMat<T,N,Lo,Hi> &a, const KVec<T,N> &v ) {
+    KVec<T,N> r(T(0));
+    for( int off=-Lo; off<=Hi; ++off ) {
+        const KVec<T,N> &d = a.Diag(off);
+        const int i0 = off < 0 ? -off : 0;
+        const int i1 = off > 0 ? N - off : N;
+        for( int i=i0; i<i1; ++i ) r(i) += d(i) * v(i+off);
+    }
+    return r;
+}
+
+template<class T, int N, int Lo, int Hi>
+KVec<T,N> prod( const KVec<T,N> &v, const KBandMat<T,N,Lo,Hi> &a ) {
+    KVec<T,N> r(T(0));
+    for( int off=-Lo; off<=Hi; ++off ) {
+        const KVec<T,N> &d = a.Diag(off);
+        const int i0 = off < 0 ? -off : 0;
+        const int i1 = off > 0 ? N - off : N;
+        for( int i=i0; i<i1; ++i ) r(i+off) += v(i) * d(i);
+    }
+    return r;
+}
+
+template<class T, int N, int Lo, int Hi, int K>
+KMat<T,N,K> prod( const KBandMat<T,N,Lo,Hi> &a, const KMat<T,N,K> &b ) {
+    KMat<T,N,K> r;
+    Detail::BandLeft(r, a, b);
+    return r;
+}
+
+template<class T, int N, int Lo, int Hi, int K>
+KMat<T,N,K> prod( const KBandMat<T,N,Lo,Hi> &a, const KMatTrans<T,N,K> &b ) {
+    KMat<T,N,K> r;
+    Detail::BandLeft(r, a, b);
+    return r;
+}
+
+template<class T, int M, int N, int Lo, int Hi>
+KMat<T,M,N> prod( const KMat<T,M,N> &b, const KBandMat<T,N,Lo,Hi> &a ) {
+    KMat<T,M,N> r;
+    Detail::BandRight(r, b, a);
+    return r;
+}
+
+template<class T, int M, int N, int Lo, int Hi>
+KMat<T,M,N> prod( const KMatTrans<T,M,N> &b, const KBandMat<T,N,Lo,Hi> &a ) {
+    KMat<T,M,N> r;
+    Detail::BandRight(r, b, a);
+    return r;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// 密な行列に足す ( 対角・帯の中だけ )
+template<class T, int N>
+KMat<T,N,N> & operator+=( KMat<T,N,N> &m, const KDiagMat<T,N> &a ) {
+    for( int i=0; i<N; ++i ) m(i,i) += a(i);
+    return m;
+}
+
+template<class T, int N, int Lo, int Hi>
+KMat<T,N,N> & operator+=( KMat<T,N,N> &m, const KBandMat<T,N,Lo,Hi> &a ) {
+    for( int off=-Lo; off<=Hi; ++off ) {
+        const KVec<T,N> &d = a.Diag(off);
+        const int i0 = off < 0 ? -off : 0;
+        const int i1 = off > 0 ? N - off : N;
+        for( int i=i0; i<i1; ++i ) m(i,i+off) += d(i);
+    }
+    return m;
+}
+
+} // namespace kblas
+
+/////////////////////////////////////////////////////////////////////////////
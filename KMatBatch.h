@@ -0,0 +1,175 @@
+﻿/////////////////////////////////////////////////////////////////////////////
+/** @file
+    @brief  同じサイズの小さな行列・ベクトルをまとめて持つ SoA コンテナ
+    @author oniprog
+*/
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "KMat.h"
+
+namespace kblas {
+
+// 行列の束 ( Structure of Arrays )
+// T 型
+// M 行サイズ
+// N 列サイズ
+// B 束ねる個数
+// 要素 (i,j) が B 個連続して並ぶので，束の方向に回すループがそのままベクトル化される
+template<class T, int M, int N, int B>
+class KMatBatch {
+public:
+    static const int SIZE_X = N;
+    static const int SIZE_Y = M;
+    static const int BATCH = B;
+public:
+
+    KMatBatch() {}
+
+    KMatBatch( const T &v ) {
+        for( int i=0; i<M*N*B; ++i ) m_v[i] = v;
+    }
+
+    T & operator()(int i, int j, int b) {
+        return m_v[(i*N+j)*B+b];
+    }
+    const T operator()(int i, int j, int b) const {
+        return m_v[(i*N+j)*B+b];
+    }
+
+    /// 要素 (i,j) の B 個の並び
+    T * Lane(int i, int j) {
+        return m_v + (i*N+j)*B;
+    }
+    const T * Lane(int i, int j) const {
+        return m_v + (i*N+j)*B;
+    }
+
+    /// b 番目に行列を入れる
+    void Set( int b, const KMat<T,M,N> &m ) {
+        for( int i=0; i<M; ++i ) for( int j=0; j<N; ++j ) {
+            (*this)(i,j,b) = m(i,j);
+        }
+    }
+
+    /// b 番目の行列を取り出す
+    KMat<T,M,N> Get( int b ) const {
+        KMat<T,M,N> m;
+        for( int i=0; i<M; ++i ) for( int j=0; j<N; ++j ) {
+            m(i,j) = (*this)(i,j,b);
+        }
+        return m;
+    }
+
+private:
+    T   m_v[M*N*B];
+};
+
+// ベクトルの束 ( Structure of Arrays )
+template<class T, int N, int B>
+class KVecBatch {
+public:
+    static const int SIZE = N;
+    static const int BATCH = B;
+public:
+
+    KVecBatch() {}
+
+    KVecBatch( const T &v ) {
+        for( int i=0; i<N*B; ++i ) m_v[i] = v;
+    }
+
+    T & operator()(int i, int b) {
+        return m_v[i*B+b];
+    }
+    const T operator()(int i, int b) const {
+        return m_v[i*B+b];
+    }
+
+    T * Lane(int i) {
+        return m_v + i*B;
+    }
+    const T * Lane(int i) const {
+        return m_v + i*B;
+    }
+
+    void Set( int b, const KVec<T,N> &v ) {
+        for( int i=0; i<N; ++i ) (*this)(i,b) = v(i);
+    }
+
+    KVec<T,N> Get( int b ) const {
+        KVec<T,N> v;
+        for( int i=0; i<N; ++i ) v(i) = (*this)(i,b);
+        return v;
+    }
+
+private:
+    T   m_v[N*B];
+};
+
+namespace Detail {
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 束の b 番目を KMat と同じ (i,j) で触るための薄いビュー
+    // スカラーのカーネルをそのまま束の方向のループに載せるのに使う
+    template<class T, int M, int N, int B>
+    class BatchLane {
+    public:
+        BatchLane( KMatBatch<T,M,N,B> &m, int b ) : m_m(m), m_b(b) {}
+
+        T & operator()(int i, int j) const {
+            return m_m(i,j,m_b);
+        }
+
+    private:
+        KMatBatch<T,M,N,B>  &m_m;
+        int                 m_b;
+    };
+
+    template<class T, int M, int N, int B>
+    class ConstBatchLane {
+    public:
+        ConstBatchLane( const KMatBatch<T,M,N,B> &m, int b ) : m_m(m), m_b(b) {}
+
+        const T operator()(int i, int j) const {
+            return m_m(i,j,m_b);
+        }
+
+    private:
+        const KMatBatch<T,M,N,B>    &m_m;
+        int                         m_b;
+    };
+
+    template<class T, int N, int B>
+    class VecBatchLane {
+    public:
+        VecBatchLane( KVecBatch<T,N,B> &v, int b ) : m_v(v), m_b(b) {}
+
+        T & operator()(int i) const {
+            return m_v(i,m_b);
+        }
+
+    private:
+        KVecBatch<T,N,B>    &m_v;
+        int                 m_b;
+    };
+
+    template<class T, int N, int B>
+    class ConstVecBatchLane {
+    public:
+        ConstVecBatchLane( const KVecBatch<T,N,B> &v, int b ) : m_v(v), m_b(b) {}
+
+        const T operator()(int i) const {
+            return m_v(i,m_b);
+        }
+
+    private:
+        const KVecBatch<T,N,B>  &m_v;
+        int                     m_b;
+    };
+}
+
+} // namespace kblas
+
+/////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,473 @@
+﻿/////////////////////////////////////////////////////////////////////////////
+/** @file
+    @brief  行列の一部を指すビュー ( ブロック，行，列，対角 )
+    @author oniprog
+*/
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "KMat.h"
+
+namespace kblas {
+
+// 行列の一部を指す読み出し専用のビュー ( コピーしない )
+// T 型
+// R 行サイズ
+// C 列サイズ
+// LD 元の行列の列サイズ ( 要素 (i,j) は p[i*LD+j] )
+// 元の行列より長く持ってはいけない
+template<class T, int R, int C, int LD>
+class KMatConstView {
+public:
+    static const int SIZE_X = C;
+    static const int SIZE_Y = R;
+    static const int STRIDE = LD;
+public:
+
+    explicit KMatConstView( const T *p ) : m_cp(p) {}
+
+    const T operator()(int i, int j) const {
+        return m_cp[i*LD+j];
+    }
+
+    /// 先頭要素
+    const T * Data() const {
+        return m_cp;
+    }
+
+    /// KMat にコピーする
+    KMat<T,R,C> Eval() const {
+        KMat<T,R,C> m;
+        for( int i=0; i<R; ++i ) for( int j=0; j<C; ++j ) m(i,j) = (*this)(i,j);
+        return m;
+    }
+
+private:
+    const T *m_cp;
+};
+
+// 書き込めるビュー．代入や += は元の行列を書き換える
+// 読み出しは KMatConstView として prod などにそのまま渡せる
+template<class T, int R, int C, int LD>
+class KMatView : public KMatConstView<T,R,C,LD> {
+public:
+    explicit KMatView( T *p ) : KMatConstView<T,R,C,LD>(p), m_p(p) {}
+    KMatView( const KMatView &m ) : KMatConstView<T,R,C,LD>(m), m_p(m.m_p) {}
+
+    T & operator()(int i, int j) const {
+        return m_p[i*LD+j];
+    }
+
+    T * Data() const {
+        return m_p;
+    }
+
+    /// 要素をコピーする ( ビューの付け替えではない )
+    KMatView & operator=( const KMatView &m ) {
+        return Assign(m);
+    }
+    template<int L2>
+    KMatView & operator=( const KMatConstView<T,R,C,L2> &m ) {
+        return Assign(m);
+    }
+    KMatView & operator=( const KMat<T,R,C> &m ) {
+        return Assign(m);
+    }
+    KMatView & operator=( const T &v ) {
+        for( int i=0; i<R; ++i ) for( int j=0; j<C; ++j ) (*this)(i,j) = v;
+        return *this;
+    }
+
+    template<int L2>
+    KMatView & operator+=( const KMatConstView<T,R,C,L2> &m ) {
+        for( int i=0; i<R; ++i ) for( int j=0; j<C; ++j ) (*this)(i,j) += m(i,j);
+        return *this;
+    }
+    KMatView & operator+=( const KMat<T,R,C> &m ) {
+        for( int i=0; i<R; ++i ) for( int j=0; j<C; ++j ) (*this)(i,j) += m(i,j);
+        return *this;
+    }
+    template<int L2>
+    KMatView & operator-=( const KMatConstView<T,R,C,L2> &m ) {
+        for( int i=0; i<R; ++i ) for( int j=0; j<C; ++j ) (*this)(i,j) -= m(i,j);
+        return *this;
+    }
+    KMatView & operator-=( const KMat<T,R,C> &m ) {
+        for( int i=0; i<R; ++i ) for( int j=0; j<C; ++j ) (*this)(i,j) -= m(i,j);
+        return *this;
+    }
+    KMatView & operator*=( const T &v ) {
+        for( int i=0; i<R; ++i ) for( int j=0; j<C; ++j ) (*this)(i,j) *= v;
+        return *this;
+    }
+
+private:
+    template<class MA>
+    KMatView & Assign( const MA &m ) {
+        for( int i=0; i<R; ++i ) for( int j=0; j<C; ++j ) (*this)(i,j) = m(i,j);
+        return *this;
+    }
+
+private:
+    T   *m_p;
+};
+
+// 行列の行・列・対角を指す読み出し専用のビュー
+// N 長さ
+// INC 要素の間隔 ( 行は 1，列は列サイズ，対角は列サイズ + 1 )
+template<class T, int N, int INC>
+class KVecConstView {
+public:
+    static const int SIZE = N;
+    static const int STRIDE = INC;
+public:
+
+    explicit KVecConstView( const T *p ) : m_cp(p) {}
+
+    const T operator()(int i) const {
+        return m_cp[i*INC];
+    }
+
+    /// KVec にコピーする
+    KVec<T,N> Eval() const {
+        KVec<T,N> v;
+        for( int i=0; i<N; ++i ) v(i) = (*this)(i);
+        return v;
+    }
+
+private:
+    const T *m_cp;
+};
+
+// 書き込めるベクトルのビュー
+template<class T, int N, int INC>
+class KVecView : public KVecConstView<T,N,INC> {
+public:
+    explicit KVecView( T *p ) : KVecConstView<T,N,INC>(p), m_p(p) {}
+    KVecView( const KVecView &v ) : KVecConstView<T,N,INC>(v), m_p(v.m_p) {}
+
+    T & operator()(int i) const {
+        return m_p[i*INC];
+    }
+
+    KVecView & operator=( const KVecView &v ) {
+        return Assign(v);
+    }
+    template<int I2>
+    KVecView & operator=( const KVecConstView<T,N,I2> &v ) {
+        return Assign(v);
+    }
+    KVecView & operator=( const KVec<T,N> &v ) {
+        return Assign(v);
+    }
+    KVecView & operator=( const T &v ) {
+        for( int i=0; i<N; ++i ) (*this)(i) = v;
+        return *this;
+    }
+
+    template<int I2>
+    KVecView & operator+=( const KVecConstView<T,N,I2> &v ) {
+        for( int i=0; i<N; ++i ) (*this)(i) += v(i);
+        return *this;
+    }
+    KVecView & operator+=( const KVec<T,N> &v ) {
+        for( int i=0; i<N; ++i ) (*this)(i) += v(i);
+        return *this;
+    }
+    template<int I2>
+    KVecView & operator-=( const KVecConstView<T,N,I2> &v ) {
+        for( int i=0; i<N; ++i ) (*this)(i) -= v(i);
+        return *this;
+    }
+    KVecView & operator-=( const KVec<T,N> &v ) {
+        for( int i=0; i<N; ++i ) (*this)(i) -= v(i);
+        return *this;
+    }
+    KVecView & operator*=( const T &v ) {
+        for( int i=0; i<N; ++i ) (*this)(i) *= v;
+        return *this;
+    }
+
+private:
+    template<class VA>
+    KVecView & Assign( const VA &v ) {
+        for( int i=0; i<N; ++i ) (*this)(i) = v(i);
+        return *this;
+    }
+
+private:
+    T   *m_p;
+};
+
+namespace Detail {
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // ビューを含む積．MA, MB は (i,j) で要素を返すもの
+    // 積の (i,j) 要素 ( k について展開 )
+    template<class T, int i, int j, int k>
+    struct ViewDot {
+        template<class MA, class MB>
+        static T f( const MA &a, const MB &b ) {
+            return ViewDot<T,i,j,k-1>::f(a, b) + a(i,k) * b(k,j);
+        }
+    };
+
+    template<class T, int i, int j>
+    struct ViewDot<T,i,j,-1> {
+        template<class MA, class MB>
+        static T f( const MA &a, const MB &b ) {
+            return T();
+        }
+    };
+
+    // 積の i 行
+    template<class T, int K, int i, int j>
+    struct ViewProdRow {
+        template<class MR, class MA, class MB>
+        static void f( MR &r, const MA &a, const MB &b ) {
+            r(i,j) = ViewDot<T,i,j,K-1>::f(a, b);
+            ViewProdRow<T,K,i,j-1>::f(r, a, b);
+        }
+    };
+
+    template<class T, int K, int i>
+    struct ViewProdRow<T,K,i,-1> {
+        template<class MR, class MA, class MB>
+        static void f( MR &r, const MA &a, const MB &b ) {
+        }
+    };
+
+    // 積 ( 行 i から 0 まで )
+    template<class T, int K, int O, int i>
+    struct ViewProd {
+        template<class MR, class MA, class MB>
+        static void f( MR &r, const MA &a, const MB &b ) {
+            ViewProdRow<T,K,i,O-1>::f(r, a, b);
+            ViewProd<T,K,O,i-1>::f(r, a, b);
+        }
+    };
+
+    template<class T, int K, int O>
+    struct ViewProd<T,K,O,-1> {
+        template<class MR, class MA, class MB>
+        static void f( MR &r, const MA &a, const MB &b ) {
+        }
+    };
+
+    // ベクトルを 1 列の行列に見せる
+    template<class T, class V>
+    struct ColOf {
+        explicit ColOf( V &v ) : m_v(v) {}
+        T & operator()(int i, int j) const { return m_v(i); }
+        V &m_v;
+    };
+
+    template<class T, class V>
+    struct ConstColOf {
+        explicit ConstColOf( const V &v ) : m_v(v) {}
+        const T operator()(int i, int j) const { return m_v(i); }
+        const V &m_v;
+    };
+
+    // ベクトルを 1 行の行列に見せる
+    template<class T, class V>
+    struct RowOf {
+        explicit RowOf( V &v ) : m_v(v) {}
+        T & operator()(int i, int j) const { return m_v(j); }
+        V &m_v;
+    };
+
+    template<class T, class V>
+    struct ConstRowOf {
+        explicit ConstRowOf( const V &v ) : m_v(v) {}
+        const T operator()(int i, int j) const { return m_v(j); }
+        const V &m_v;
+    };
+
+    // M x K と K x O の積を KMat に
+    template<class T, int M, int K, int O, class MA, class MB>
+    KMat<T,M,O> ViewMM( const MA &a, const MB &b ) {
+        KMat<T,M,O> r;
+        ViewProd<T,K,O,M-1>::f(r, a, b);
+        return r;
+    }
+
+    // M x K と長さ K のベクトルの積
+    template<class T, int M, int K, class MA, class VB>
+    KVec<T,M> ViewMV( const MA &a, const VB &v ) {
+        KVec<T,M> r;
+        ColOf< T,KVec<T,M> > rc(r);
+        ViewProd<T,K,1,M-1>::f(rc, a, ConstColOf<T,VB>(v));
+        return r;
+    }
+
+    // 長さ M のベクトルと M x N の積
+    template<class T, int M, int N, class VA, class MB>
+    KVec<T,N> ViewVM( const VA &v, const MB &b ) {
+        KVec<T,N> r;
+        RowOf< T,KVec<T,N> > rr(r);
+        ViewProd<T,M,N,0>::f(rr, ConstRowOf<T,VA>(v), b);
+        return r;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// A の (R0,C0) から R x C のブロック ( 範囲はコンパイル時に確かめる )
+template<int R0, int C0, int R, int C, class T, int M, int N>
+KMatView<T,R,C,N> block( KMat<T,M,N> &a ) {
+    static_assert( R0 >= 0 && C0 >= 0 && R > 0 && C > 0, "block: bad offset or size" );
+    static_assert( R0 + R <= M && C0 + C <= N, "block: out of range" );
+    return KMatView<T,R,C,N>( &a(R0,C0) );
+}
+
+template<int R0, int C0, int R, int C, class T, int M, int N>
+KMatConstView<T,R,C,N> block( const KMat<T,M,N> &a ) {
+    static_assert( R0 >= 0 && C0 >= 0 && R > 0 && C > 0, "block: bad offset or size" );
+    static_assert( R0 + R <= M && C0 + C <= N, "block: out of range" );
+    return KMatConstView<T,R,C,N>( a.Data() + R0 * N + C0 );
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// ブロックのブロック
+template<int R0, int C0, int R, int C, class T, int M, int N, int LD>
+KMatView<T,R,C,LD> block( const KMatView<T,M,N,LD> &a ) {
+    static_assert( R0 >= 0 && C0 >= 0 && R > 0 && C > 0, "block: bad offset or size" );
+    static_assert( R0 + R <= M && C0 + C <= N, "block: out of range" );
+    return KMatView<T,R,C,LD>( &a(R0,C0) );
+}
+
+template<int R0, int C0, int R, int C, class T, int M, int N, int LD>
+KMatConstView<T,R,C,LD> block( const KMatConstView<T,M,N,LD> &a ) {
+    static_assert( R0 >= 0 && C0 >= 0 && R > 0 && C > 0, "block: bad offset or size" );
+    static_assert( R0 + R <= M && C0 + C <= N, "block: out of range" );
+    return KMatConstView<T,R,C,LD>( a.Data() + R0 * LD + C0 );
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// I 行目
+template<int I, class T, int M, int N>
+KVecView<T,N,1> row( KMat<T,M,N> &a ) {
+    static_assert( I >= 0 && I < M, "row: out of range" );
+    return KVecView<T,N,1>( &a(I,0) );
+}
+
+template<int I, class T, int M, int N>
+KVecConstView<T,N,1> row( const KMat<T,M,N> &a ) {
+    static_assert( I >= 0 && I < M, "row: out of range" );
+    return KVecConstView<T,N,1>( a.Data() + I * N );
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// J 列目
+template<int J, class T, int M, int N>
+KVecView<T,M,N> col( KMat<T,M,N> &a ) {
+    static_assert( J >= 0 && J < N, "col: out of range" );
+    return KVecView<T,M,N>( &a(0,J) );
+}
+
+template<int J, class T, int M, int N>
+KVecConstView<T,M,N> col( const KMat<T,M,N> &a ) {
+    static_assert( J >= 0 && J < N, "col: out of range" );
+    return KVecConstView<T,M,N>( a.Data() + J );
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 対角 ( 長さ min(M,N) )
+template<class T, int M, int N>
+KVecView<T,(M < N ? M : N),N+1> diagonal( KMat<T,M,N> &a ) {
+    return KVecView<T,(M < N ? M : N),N+1>( a.Data() );
+}
+
+template<class T, int M, int N>
+KVecConstView<T,(M < N ? M : N),N+1> diagonal( const KMat<T,M,N> &a ) {
+    return KVecConstView<T,(M < N ? M : N),N+1>( a.Data() );
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// ビューの積 ( 要素を直接読むので，ブロックをコピーしない )
+template<class T, int M, int K, int O, int LA>
+KMat<T,M,O> prod( const KMatConstView<T,M,K,LA> &a, const KMat<T,K,O> &b ) {
+    return Detail::ViewMM<T,M,K,O>(a, b);
+}
+
+template<class T, int M, int K, int O, int LB>
+KMat<T,M,O> prod( const KMat<T,M,K> &a, const KMatConstView<T,K,O,LB> &b ) {
+    return Detail::ViewMM<T,M,K,O>(a, b);
+}
+
+template<class T, int M, int K, int O, int LA, int LB>
+KMat<T,M,O> prod( const KMatConstView<T,M,K,LA> &a, const KMatConstView<T,K,O,LB> &b ) {
+    return Detail::ViewMM<T,M,K,O>(a, b);
+}
+
+template<class T, int M, int K, int LA>
+KVec<T,M> prod( const KMatConstView<T,M,K,LA> &a, const KVec<T,K> &v ) {
+    return Detail::ViewMV<T,M,K>(a, v);
+}
+
+template<class T, int M, int K, int IB>
+KVec<T,M> prod( const KMat<T,M,K> &a, const KVecConstView<T,K,IB> &v ) {
+    return Detail::ViewMV<T,M,K>(a, v);
+}
+
+template<class T, int M, int K, int LA, int IB>
+KVec<T,M> prod( const KMatConstView<T,M,K,LA> &a, const KVecConstView<T,K,IB> &v ) {
+    return Detail::ViewMV<T,M,K>(a, v);
+}
+
+template<class T, int M, int N, int IA>
+KVec<T,N> prod( const KVecConstView<T,M,IA> &v, const KMat<T,M,N> &b ) {
+    return Detail::ViewVM<T,M,N>(v, b);
+}
+
+template<class T, int M, int N, int LB>
+KVec<T,N> prod( const KVec<T,M> &v, const KMatConstView<T,M,N,LB> &b ) {
+    return Detail::ViewVM<T,M,N>(v, b);
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// KMat / KVec にビューを足す・引く
+template<class T, int M, int N, int L>
+KMat<T,M,N> & operator+=( KMat<T,M,N> &a, const KMatConstView<T,M,N,L> &b ) {
+    for( int i=0; i<M; ++i ) for( int j=0; j<N; ++j ) a(i,j) += b(i,j);
+    return a;
+}
+
+template<class T, int M, int N, int L>
+KMat<T,M,N> & operator-=( KMat<T,M,N> &a, const KMatConstView<T,M,N,L> &b ) {
+    for( int i=0; i<M; ++i ) for( int j=0; j<N; ++j ) a(i,j) -= b(i,j);
+    return a;
+}
+
+template<class T, int N, int I>
+KVec<T,N> & operator+=( KVec<T,N> &a, const KVecConstView<T,N,I> &b ) {
+    for( int i=0; i<N; ++i ) a(i) += b(i);
+    return a;
+}
+
+template<class T, int N, int I>
+KVec<T,N> & operator-=( KVec<T,N> &a, const KVecConstView<T,N,I> &b ) {
+    for( int i=0; i<N; ++i ) a(i) -= b(i);
+    return a;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// operator * (View, C)
+template<class T, int R, int C, int L>
+KMat<T,R,C> operator * ( const KMatConstView<T,R,C,L> &m1, const T &v ) {
+    KMat<T,R,C> ret;
+    for( int i=0; i<R; ++i ) for( int j=0; j<C; ++j ) ret(i,j) = m1(i,j) * v;
+    return ret;
+}
+
+template<class T, int N, int I>
+KVec<T,N> operator * ( const KVecConstView<T,N,I> &v1, const T &v ) {
+    KVec<T,N> ret;
+    for( int i=0; i<N; ++i ) ret(i) = v1(i) * v;
+    return ret;
+}
+
+} // namespace kblas
+
+/////////////////////////////////////////////////////////////////////////////
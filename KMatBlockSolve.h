@@ -0,0 +1,195 @@
+﻿/////////////////////////////////////////////////////////////////////////////
+/** @file
+    @brief  2x2 に分割した行列の Schur 補行列による解法と逆行列
+    @author oniprog
+*/
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "KMat.h"
+#include "KMatBlock.h"
+#include "KMatChol.h"
+#include "KMatLU.h"
+
+namespace kblas {
+
+namespace Detail {
+
+    // ブロックの分解 ( 対称正定値なら Cholesky, そうでなければ LU )
+    template<class T, int N, bool SPD>
+    struct BlockFactor {
+        typedef KLU<T,N> Type;
+    };
+
+    template<class T, int N>
+    struct BlockFactor<T,N,true> {
+        typedef KCholesky<T,N> Type;
+    };
+
+    template<class T, int N>
+    KMat<T,N,N> Identity() {
+        KMat<T,N,N> m(T(0));
+        for( int i=0; i<N; ++i ) m(i,i) = T(1);
+        return m;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// A = [ A11 A12 ; A21 A22 ] ( A11 は P x P, A22 は Q x Q ) を Schur 補行列で解く
+///   S = A22 - A21 A11^{-1} A12
+/// A11 と S だけを分解するので，N = P + Q の密な分解より軽い
+/// SPD が true なら A を対称正定値とみなして両方を Cholesky で，そうでなければ LU で分解する
+template<class T, int P, int Q, bool SPD = false>
+class KBlockSolver {
+    static_assert( P > 0 && Q > 0, "KBlockSolver needs P > 0 and Q > 0" );
+public:
+    static const int SIZE = P + Q;
+    typedef typename Detail::BlockFactor<T,P,SPD>::Type Factor1;
+    typedef typename Detail::BlockFactor<T,Q,SPD>::Type FactorS;
+
+public:
+    KBlockSolver() : m_ok(false) {}
+
+    explicit KBlockSolver( const KMat<T,P+Q,P+Q> &a ) {
+        Compute(a);
+    }
+
+    /// 分解する．A11 か S が分解できなければ false
+    bool Compute( const KMat<T,P+Q,P+Q> &a ) {
+        m_ok = false;
+        if( !m_f1.Compute( block<0,0,P,P>(a).Eval() ) ) return false;
+
+        // X = A11^{-1} A12, S = A22 - A21 X
+        // 分解に渡すブロックは KMat にするが，積にはビューをそのまま渡す
+        m_x = m_f1.Solve( block<0,P,P,Q>(a).Eval() );
+        m_s = block<P,P,Q,Q>(a).Eval();
+        const KMat<T,Q,Q> ax = prod( block<P,0,Q,P>(a), m_x );
+        for( int i=0; i<Q; ++i ) for( int j=0; j<Q; ++j ) m_s(i,j) -= ax(i,j);
+        m_a21 = block<P,0,Q,P>(a).Eval();      // Solve と Inverse で使う
+        if( SPD ) {
+            // 丸め誤差で崩れた対称性を戻す
+            for( int i=0; i<Q; ++i ) for( int j=0; j<i; ++j ) {
+                const T v = (m_s(i,j) + m_s(j,i)) / 2;
+                m_s(i,j) = v;
+                m_s(j,i) = v;
+            }
+        }
+        m_ok = m_fs.Compute(m_s);
+        return m_ok;
+    }
+
+    bool IsOk() const {
+        return m_ok;
+    }
+
+    /// Schur 補行列 S
+    const KMat<T,Q,Q> & MatS() const {
+        return m_s;
+    }
+
+    /// A x = b を解く
+    ///   y1 = A11^{-1} b1, x2 = S^{-1} (b2 - A21 y1), x1 = y1 - X x2
+    KVec<T,P+Q> Solve( const KVec<T,P+Q> &b ) const {
+        KVec<T,P> b1;
+        KVec<T,Q> b2;
+        for( int i=0; i<P; ++i ) b1(i) = b(i);
+        for( int i=0; i<Q; ++i ) b2(i) = b(P+i);
+
+        const KVec<T,P> y1 = m_f1.Solve(b1);
+        const KVec<T,Q> a21y = prod(m_a21, y1);
+        for( int i=0; i<Q; ++i ) b2(i) -= a21y(i);
+        const KVec<T,Q> x2 = m_fs.Solve(b2);
+        const KVec<T,P> xx = prod(m_x, x2);
+
+        KVec<T,P+Q> x;
+        for( int i=0; i<P; ++i ) x(i) = y1(i) - xx(i);
+        for( int i=0; i<Q; ++i ) x(P+i) = x2(i);
+        return x;
+    }
+
+    /// A X = B を解く ( 複数右辺 )
+    template<int K>
+    KMat<T,P+Q,K> Solve( const KMat<T,P+Q,K> &b ) const {
+        const KMat<T,P,K> y1 = m_f1.Solve( block<0,0,P,K>(b).Eval() );
+        KMat<T,Q,K> b2 = block<P,0,Q,K>(b).Eval();
+        const KMat<T,Q,K> ay = prod(m_a21, y1);
+        for( int i=0; i<Q; ++i ) for( int j=0; j<K; ++j ) b2(i,j) -= ay(i,j);
+        const KMat<T,Q,K> x2 = m_fs.Solve(b2);
+
+        KMat<T,P+Q,K> x;
+        block<0,0,P,K>(x) = y1;
+        block<0,0,P,K>(x) -= prod(m_x, x2);
+        block<P,0,Q,K>(x) = x2;
+        return x;
+    }
+
+    /// A^{-1} = [ A11^{-1} + X S^{-1} Y , -X S^{-1} ; -S^{-1} Y , S^{-1} ]  ( Y = A21 A11^{-1} )
+    KMat<T,P+Q,P+Q> Inverse() const {
+        const KMat<T,Q,Q> si = m_fs.Solve( Detail::Identity<T,Q>() );
+        const KMat<T,P,P> a11i = m_f1.Solve( Detail::Identity<T,P>() );
+        const KMat<T,Q,P> y = prod(m_a21, a11i);
+        const KMat<T,P,Q> xsi = prod(m_x, si);
+
+        KMat<T,P+Q,P+Q> r;
+        block<0,0,P,P>(r) = a11i;
+        block<0,0,P,P>(r) += prod(xsi, y);
+        block<0,P,P,Q>(r) = xsi;
+        block<0,P,P,Q>(r) *= T(-1);
+        block<P,0,Q,P>(r) = prod(si, y);
+        block<P,0,Q,P>(r) *= T(-1);
+        block<P,P,Q,Q>(r) = si;
+        return r;
+    }
+
+private:
+    Factor1     m_f1;
+    FactorS     m_fs;
+    KMat<T,P,Q> m_x;
+    KMat<T,Q,P> m_a21;
+    KMat<T,Q,Q> m_s;
+    bool        m_ok;
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 先頭 P 行 P 列で分割して A x = b を解く ( x は b を上書き )
+/// 分解できなければ x には触らずに false を返す
+template<int P, class T, int N>
+bool block_solve( const KMat<T,N,N> &a, KVec<T,N> &x ) {
+    const KBlockSolver<T,P,N-P> f(a);
+    if( !f.IsOk() ) return false;
+    x = f.Solve(x);
+    return true;
+}
+
+/// block_solve ( 対称正定値 )
+template<int P, class T, int N>
+bool block_solve_spd( const KMat<T,N,N> &a, KVec<T,N> &x ) {
+    const KBlockSolver<T,P,N-P,true> f(a);
+    if( !f.IsOk() ) return false;
+    x = f.Solve(x);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 先頭 P 行 P 列で分割して逆行列を求める．分解できなければ inv には触らずに false を返す
+template<int P, class T, int N>
+bool block_inverse( const KMat<T,N,N> &a, KMat<T,N,N> &inv ) {
+    const KBlockSolver<T,P,N-P> f(a);
+    if( !f.IsOk() ) return false;
+    inv = f.Inverse();
+    return true;
+}
+
+/// block_inverse ( 対称正定値 )
+template<int P, class T, int N>
+bool block_inverse_spd( const KMat<T,N,N> &a, KMat<T,N,N> &inv ) {
+    const KBlockSolver<T,P,N-P,true> f(a);
+    if( !f.IsOk() ) return false;
+    inv = f.Inverse();
+    return true;
+}
+
+} // namespace kblas
+
+/////////////////////////////////////////////////////////////////////////////
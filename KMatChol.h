@@ -0,0 +1,380 @@
+﻿/////////////////////////////////////////////////////////////////////////////
+/** @file
+    @brief  対称正定値行列の Cholesky 分解 (LL^T) と LDL^T 分解
+    @author oniprog
+*/
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cmath>
+
+#include "KMat.h"
+#include "KMatTri.h"
+
+namespace kblas {
+
+namespace Detail {
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // Cholesky 分解 A = L L^T
+    // 下三角しか参照しないので，上三角は何が入っていても良い
+
+    // L の i 行と j 行の内積 ( 0 .. k 列 )
+    template<class T, int N, int i, int j, int k>
+    struct CholDot {
+        static T f( const KMat<T,N,N> &l ) {
+            return CholDot<T,N,i,j,k-1>::f(l) + l(i,k) * l(j,k);
+        }
+    };
+
+    template<class T, int N, int i, int j>
+    struct CholDot<T,N,i,j,-1> {
+        static T f( const KMat<T,N,N> &l ) {
+            return T();
+        }
+    };
+
+    // i 行目の非対角部分 ( j = 0 .. j )
+    template<class T, int N, int i, int j>
+    struct Chol_2 {
+        static void f( KMat<T,N,N> &l, const KMat<T,N,N> &a ) {
+            Chol_2<T,N,i,j-1>::f(l, a);
+            l(i,j) = (a(i,j) - CholDot<T,N,i,j,j-1>::f(l)) / l(j,j);
+            l(j,i) = T();
+        }
+    };
+
+    template<class T, int N, int i>
+    struct Chol_2<T,N,i,-1> {
+        static void f( KMat<T,N,N> &l, const KMat<T,N,N> &a ) {
+        }
+    };
+
+    // 0 .. i 行目まで．対角が正でなくなった時点で false を返す
+    template<class T, int N, int i>
+    struct Chol_1 {
+        static bool f( KMat<T,N,N> &l, const KMat<T,N,N> &a ) {
+            if( !Chol_1<T,N,i-1>::f(l, a) ) return false;
+            Chol_2<T,N,i,i-1>::f(l, a);
+            const T d = a(i,i) - CholDot<T,N,i,i,i-1>::f(l);
+            if( !(d > T()) ) return false;
+            l(i,i) = std::sqrt(d);
+            return true;
+        }
+    };
+
+    template<class T, int N>
+    struct Chol_1<T,N,-1> {
+        static bool f( KMat<T,N,N> &l, const KMat<T,N,N> &a ) {
+            return true;
+        }
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // LDL^T 分解 A = L D L^T ( L は単位下三角 )
+
+    // sum L(i,k) L(j,k) D(k)
+    template<class T, int N, int i, int j, int k>
+    struct LdltDot {
+        static T f( const KMat<T,N,N> &l, const KVec<T,N> &d ) {
+            return LdltDot<T,N,i,j,k-1>::f(l, d) + l(i,k) * l(j,k) * d(k);
+        }
+    };
+
+    template<class T, int N, int i, int j>
+    struct LdltDot<T,N,i,j,-1> {
+        static T f( const KMat<T,N,N> &l, const KVec<T,N> &d ) {
+            return T();
+        }
+    };
+
+    template<class T, int N, int i, int j>
+    struct Ldlt_2 {
+        static void f( KMat<T,N,N> &l, KVec<T,N> &d, const KMat<T,N,N> &a ) {
+            Ldlt_2<T,N,i,j-1>::f(l, d, a);
+            l(i,j) = (a(i,j) - LdltDot<T,N,i,j,j-1>::f(l, d)) / d(j);
+            l(j,i) = T();
+        }
+    };
+
+    template<class T, int N, int i>
+    struct Ldlt_2<T,N,i,-1> {
+        static void f( KMat<T,N,N> &l, KVec<T,N> &d, const KMat<T,N,N> &a ) {
+        }
+    };
+
+    // ピボットが 0 になった時点で false を返す
+    template<class T, int N, int i>
+    struct Ldlt_1 {
+        static bool f( KMat<T,N,N> &l, KVec<T,N> &d, const KMat<T,N,N> &a ) {
+            if( !Ldlt_1<T,N,i-1>::f(l, d, a) ) return false;
+            Ldlt_2<T,N,i,i-1>::f(l, d, a);
+            d(i) = a(i,i) - LdltDot<T,N,i,i,i-1>::f(l, d);
+            l(i,i) = T(1);
+            return d(i) != T();
+        }
+    };
+
+    template<class T, int N>
+    struct Ldlt_1<T,N,-1> {
+        static bool f( KMat<T,N,N> &l, KVec<T,N> &d, const KMat<T,N,N> &a ) {
+            return true;
+        }
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 下三角 L の逆行列 W = L^{-1} から W^T diag(s) W を作る ( 下三角だけ計算して写す )
+    template<class T, int N>
+    KMat<T,N,N> SymInvFromLower( const KMat<T,N,N> &l, const KVec<T,N> &s, bool unit ) {
+
+        // W = L^{-1} ( 下三角 )
+        KMat<T,N,N> w(T(0));
+        for( int j=0; j<N; ++j ) {
+            w(j,j) = unit ? T(1) : T(1) / l(j,j);
+            for( int i=j+1; i<N; ++i ) {
+                T sum = T();
+                for( int k=j; k<i; ++k ) sum += l(i,k) * w(k,j);
+                w(i,j) = unit ? -sum : -sum / l(i,i);
+            }
+        }
+
+        KMat<T,N,N> r;
+        for( int i=0; i<N; ++i ) for( int j=0; j<=i; ++j ) {
+            T sum = T();
+            for( int k=i; k<N; ++k ) sum += w(k,i) * s(k) * w(k,j);
+            r(i,j) = sum;
+            r(j,i) = sum;
+        }
+        return r;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // L L^T +- x x^T の下三角因子を L に上書きする ( O(N^2) )
+    // 追加は Givens 回転，削除は双曲回転．削除で正定値でなくなったら false ( L は途中まで書き換わる )
+    template<class T, int N, bool DOWN>
+    bool CholRank1( KMat<T,N,N> &l, KVec<T,N> x ) {
+        for( int k=0; k<N; ++k ) {
+            const T lkk = l(k,k);
+            const T xk = x(k);
+            const T r2 = DOWN ? (lkk - xk) * (lkk + xk) : lkk * lkk + xk * xk;
+            if( !(r2 > T()) ) return false;
+            const T r = std::sqrt(r2);
+            const T c = r / lkk;
+            const T s = xk / lkk;
+            const T ic = T(1) / c;
+            l(k,k) = r;
+            for( int i=k+1; i<N; ++i ) {
+                const T lik = DOWN ? (l(i,k) - s * x(i)) * ic : (l(i,k) + s * x(i)) * ic;
+                l(i,k) = lik;
+                x(i) = c * x(i) - s * lik;
+            }
+        }
+        return true;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// Cholesky 分解 A = L L^T
+/// 失敗したときに例外は投げず IsOk() が false になる
+template<class T, int N>
+class KCholesky {
+public:
+    KCholesky() : m_ok(false) {}
+
+    explicit KCholesky( const KMat<T,N,N> &a ) {
+        Compute(a);
+    }
+
+    /// 分解する．A は下三角だけ参照する
+    bool Compute( const KMat<T,N,N> &a ) {
+        m_ok = Detail::Chol_1<T,N,N-1>::f(m_l, a);
+        return m_ok;
+    }
+
+    bool IsOk() const {
+        return m_ok;
+    }
+
+    /// 下三角因子 L
+    const KMat<T,N,N> & MatL() const {
+        return m_l;
+    }
+
+    /// A x = b を解く
+    KVec<T,N> Solve( const KVec<T,N> &b ) const {
+        KVec<T,N> x(b);
+        trsv<KLower,KNonUnit>(m_l, x);
+        trsv_trans<KLower,KNonUnit>(m_l, x);
+        return x;
+    }
+
+    /// A X = B を解く ( 複数右辺 )
+    template<int K>
+    KMat<T,N,K> Solve( const KMat<T,N,K> &b ) const {
+        KMat<T,N,K> r;
+        for( int j=0; j<K; ++j ) {
+            KVec<T,N> x;
+            for( int i=0; i<N; ++i ) x(i) = b(i,j);
+            x = Solve(x);
+            for( int i=0; i<N; ++i ) r(i,j) = x(i);
+        }
+        return r;
+    }
+
+    /// log det(A)
+    T LogDet() const {
+        T sum = T();
+        for( int i=0; i<N; ++i ) sum += std::log(m_l(i,i));
+        return 2 * sum;
+    }
+
+    /// A を A + x x^T に更新する ( O(N^2) )．分解できていない，または失敗したときは何もせず false を返す
+    bool Update( const KVec<T,N> &x ) {
+        if( !m_ok ) return false;
+        KMat<T,N,N> l(m_l);
+        if( !Detail::CholRank1<T,N,false>(l, x) ) return false;
+        m_l = l;
+        return true;
+    }
+
+    /// A を A - x x^T に更新する ( O(N^2) )．分解できていない，または正定値でなくなるときは何もせず false を返す
+    bool Downdate( const KVec<T,N> &x ) {
+        if( !m_ok ) return false;
+        KMat<T,N,N> l(m_l);
+        if( !Detail::CholRank1<T,N,true>(l, x) ) return false;
+        m_l = l;
+        return true;
+    }
+
+    /// A^{-1}
+    KMat<T,N,N> Inverse() const {
+        return Detail::SymInvFromLower<T,N>(m_l, KVec<T,N>(T(1)), false);
+    }
+
+private:
+    KMat<T,N,N> m_l;
+    bool        m_ok;
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+/// LDL^T 分解 A = L D L^T ( L は単位下三角 )
+/// 平方根を使わない．ピボットが 0 のときは IsOk() が false になる
+template<class T, int N>
+class KLDLT {
+public:
+    KLDLT() : m_ok(false) {}
+
+    explicit KLDLT( const KMat<T,N,N> &a ) {
+        Compute(a);
+    }
+
+    /// 分解する．A は下三角だけ参照する
+    bool Compute( const KMat<T,N,N> &a ) {
+        m_ok = Detail::Ldlt_1<T,N,N-1>::f(m_l, m_d, a);
+        return m_ok;
+    }
+
+    bool IsOk() const {
+        return m_ok;
+    }
+
+    /// 単位下三角因子 L
+    const KMat<T,N,N> & MatL() const {
+        return m_l;
+    }
+
+    /// 対角 D
+    const KVec<T,N> & VecD() const {
+        return m_d;
+    }
+
+    /// 全てのピボットが正 ( A が正定値 ) か
+    bool IsPositive() const {
+        if( !m_ok ) return false;
+        for( int i=0; i<N; ++i ) if( !(m_d(i) > T()) ) return false;
+        return true;
+    }
+
+    /// A x = b を解く
+    KVec<T,N> Solve( const KVec<T,N> &b ) const {
+        KVec<T,N> x(b);
+        trsv<KLower,KUnit>(m_l, x);
+        for( int i=0; i<N; ++i ) x(i) /= m_d(i);
+        trsv_trans<KLower,KUnit>(m_l, x);
+        return x;
+    }
+
+    /// A X = B を解く ( 複数右辺 )
+    template<int K>
+    KMat<T,N,K> Solve( const KMat<T,N,K> &b ) const {
+        KMat<T,N,K> r;
+        for( int j=0; j<K; ++j ) {
+            KVec<T,N> x;
+            for( int i=0; i<N; ++i ) x(i) = b(i,j);
+            x = Solve(x);
+            for( int i=0; i<N; ++i ) r(i,j) = x(i);
+        }
+        return r;
+    }
+
+    /// log |det(A)|
+    T LogDet() const {
+        T sum = T();
+        for( int i=0; i<N; ++i ) sum += std::log(std::abs(m_d(i)));
+        return sum;
+    }
+
+    /// A^{-1}
+    KMat<T,N,N> Inverse() const {
+        KVec<T,N> s;
+        for( int i=0; i<N; ++i ) s(i) = T(1) / m_d(i);
+        return Detail::SymInvFromLower<T,N>(m_l, s, true);
+    }
+
+private:
+    KMat<T,N,N> m_l;
+    KVec<T,N>   m_d;
+    bool        m_ok;
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+/// cholesky
+template<class T, int N>
+KCholesky<T,N> cholesky( const KMat<T,N,N> &a ) {
+    return KCholesky<T,N>(a);
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// chol_update
+/// 下三角の Cholesky 因子 L ( A = L L^T ) を A + x x^T の因子に書き換える ( O(N^2) )
+/// L の対角は正であること．そうでない ( NaN を含む ) ときは L には触らずに false を返す
+template<class T, int N>
+bool chol_update( KMat<T,N,N> &l, const KVec<T,N> &x ) {
+    KMat<T,N,N> r(l);
+    if( !Detail::CholRank1<T,N,false>(r, x) ) return false;
+    l = r;
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// chol_downdate
+/// L を A - x x^T の因子に書き換える．A - x x^T が正定値でなければ L には触らずに false を返す
+template<class T, int N>
+bool chol_downdate( KMat<T,N,N> &l, const KVec<T,N> &x ) {
+    KMat<T,N,N> r(l);
+    if( !Detail::CholRank1<T,N,true>(r, x) ) return false;
+    l = r;
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// ldlt
+template<class T, int N>
+KLDLT<T,N> ldlt( const KMat<T,N,N> &a ) {
+    return KLDLT<T,N>(a);
+}
+
+} // namespace kblas
+
+/////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,397 @@
+﻿/////////////////////////////////////////////////////////////////////////////
+/** @file
+    @brief  対称行列の固有値分解 ( 巡回 Jacobi 法，3x3 は閉じた式も )
+    @author oniprog
+*/
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "KMat.h"
+#include "KMatBatch.h"
+
+namespace kblas {
+
+namespace Detail {
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // Jacobi 回転の係数 ( a(p,q) を消す )
+    // tan を分母が 0 にならない形で求める．a(p,q) = 0 のときは c = 1, s = 0
+    template<class T>
+    inline void JacobiCoef( const T &app, const T &aqq, const T &apq, T &c, T &s, T &t ) {
+        const T tau = aqq - app;
+        const T den = std::abs(tau) + std::sqrt(tau * tau + 4 * apq * apq);
+        t = den > T() ? (tau >= T() ? 2 * apq : -2 * apq) / den : T();
+        c = T(1) / std::sqrt(T(1) + t * t);
+        s = t * c;
+    }
+
+    // (p,q) の回転を a ( 対称，全体を持つ ) と v に掛ける
+    template<class T, int N, int p, int q>
+    struct JacobiRot {
+        static void f( KMat<T,N,N> &a, KMat<T,N,N> *v ) {
+            const T apq = a(p,q);
+            if( apq == T() ) return;
+
+            T c, s, t;
+            JacobiCoef( a(p,p), a(q,q), apq, c, s, t );
+
+            for( int k=0; k<N; ++k ) {
+                if( k == p || k == q ) continue;
+                const T akp = a(k,p), akq = a(k,q);
+                a(k,p) = a(p,k) = c * akp - s * akq;
+                a(k,q) = a(q,k) = s * akp + c * akq;
+            }
+            a(p,p) -= t * apq;
+            a(q,q) += t * apq;
+            a(p,q) = a(q,p) = T();
+
+            if( v ) {
+                KMat<T,N,N> &vv = *v;
+                for( int k=0; k<N; ++k ) {
+                    const T vkp = vv(k,p), vkq = vv(k,q);
+                    vv(k,p) = c * vkp - s * vkq;
+                    vv(k,q) = s * vkp + c * vkq;
+                }
+            }
+        }
+    };
+
+    // 1 巡分 ( p 行の q = p+1 .. q )
+    template<class T, int N, int p, int q>
+    struct JacobiSweep_2 {
+        static void f( KMat<T,N,N> &a, KMat<T,N,N> *v ) {
+            JacobiSweep_2<T,N,p,q-1>::f(a, v);
+            JacobiRot<T,N,p,q>::f(a, v);
+        }
+    };
+
+    template<class T, int N, int p>
+    struct JacobiSweep_2<T,N,p,p> {
+        static void f( KMat<T,N,N> &a, KMat<T,N,N> *v ) {
+        }
+    };
+
+    template<class T, int N, int p>
+    struct JacobiSweep_1 {
+        static void f( KMat<T,N,N> &a, KMat<T,N,N> *v ) {
+            JacobiSweep_1<T,N,p-1>::f(a, v);
+            JacobiSweep_2<T,N,p,N-1>::f(a, v);
+        }
+    };
+
+    template<class T, int N>
+    struct JacobiSweep_1<T,N,-1> {
+        static void f( KMat<T,N,N> &a, KMat<T,N,N> *v ) {
+        }
+    };
+
+    // 非対角成分の二乗和
+    template<class T, int N>
+    T OffDiag2( const KMat<T,N,N> &a ) {
+        T sum = T();
+        for( int i=0; i<N; ++i ) for( int j=i+1; j<N; ++j ) sum += a(i,j) * a(i,j);
+        return sum;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 3x3 の閉じた式で使う補助
+
+    inline void Cross3( const double a[3], const double b[3], double r[3] ) {
+        r[0] = a[1] * b[2] - a[2] * b[1];
+        r[1] = a[2] * b[0] - a[0] * b[2];
+        r[2] = a[0] * b[1] - a[1] * b[0];
+    }
+
+    // A - lambda I の行の外積から固有ベクトルを作る．ランクが落ちていれば false
+    template<class T>
+    bool EigVec3( const KMat<T,3,3> &a, const T &lambda, double r[3] ) {
+        double row[3][3];
+        for( int i=0; i<3; ++i ) for( int j=0; j<3; ++j ) {
+            row[i][j] = double(a(i,j)) - (i == j ? double(lambda) : 0.0);
+        }
+        double c[3][3];
+        Cross3( row[0], row[1], c[0] );
+        Cross3( row[0], row[2], c[1] );
+        Cross3( row[1], row[2], c[2] );
+
+        int best = 0;
+        double bn = -1;
+        for( int i=0; i<3; ++i ) {
+            const double n = c[i][0] * c[i][0] + c[i][1] * c[i][1] + c[i][2] * c[i][2];
+            if( n > bn ) { bn = n; best = i; }
+        }
+        double scale = 0;
+        for( int i=0; i<3; ++i ) for( int j=0; j<3; ++j ) scale += row[i][j] * row[i][j];
+        if( !(bn > 1E-24 * scale * scale) ) return false;
+
+        const double inv = 1.0 / std::sqrt(bn);
+        for( int i=0; i<3; ++i ) r[i] = c[best][i] * inv;
+        return true;
+    }
+
+    // u に直交する単位ベクトル
+    inline void Orthogonal3( const double u[3], double r[3] ) {
+        if( std::abs(u[0]) > std::abs(u[1]) ) {
+            const double inv = 1.0 / std::sqrt(u[0] * u[0] + u[2] * u[2]);
+            r[0] = -u[2] * inv; r[1] = 0; r[2] = u[0] * inv;
+        } else {
+            const double inv = 1.0 / std::sqrt(u[1] * u[1] + u[2] * u[2]);
+            r[0] = 0; r[1] = u[2] * inv; r[2] = -u[1] * inv;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 対称行列の固有値分解 A = V diag(w) V^T
+/// 固有値は昇順，V の列が対応する固有ベクトル
+template<class T, int N>
+class KSymEigen {
+public:
+    /// 収束判定付きのときの巡回数の上限
+    static const int MAX_SWEEPS = 50;
+
+public:
+    KSymEigen() : m_sweeps(0) {}
+
+    explicit KSymEigen( const KMat<T,N,N> &a, bool vectors = true ) {
+        Compute(a, vectors);
+    }
+
+    /// 巡回 Jacobi 法．A は対称であること
+    /// sweeps > 0 のときは収束判定をせずにちょうどその回数だけ回す ( 所要時間が一定 )
+    void Compute( const KMat<T,N,N> &a, bool vectors = true, int sweeps = 0 ) {
+        KMat<T,N,N> d(a);
+        InitVectors();
+        KMat<T,N,N> *v = vectors ? &m_v : 0;
+
+        if( sweeps > 0 ) {
+            for( int i=0; i<sweeps; ++i ) Detail::JacobiSweep_1<T,N,N-2>::f(d, v);
+            m_sweeps = sweeps;
+        } else {
+            T fro2 = T();
+            for( int i=0; i<N; ++i ) for( int j=0; j<N; ++j ) fro2 += a(i,j) * a(i,j);
+            const T eps = std::numeric_limits<T>::epsilon();
+            const T tol = eps * eps * fro2;
+            m_sweeps = 0;
+            while( m_sweeps < MAX_SWEEPS && Detail::OffDiag2(d) > tol ) {
+                Detail::JacobiSweep_1<T,N,N-2>::f(d, v);
+                ++m_sweeps;
+            }
+        }
+
+        for( int i=0; i<N; ++i ) m_w(i) = d(i,i);
+        Sort();
+    }
+
+    /// 3x3 専用の閉じた式 ( 三角関数による解法 )．Jacobi より速いが精度は落ちる
+    void ComputeClosed( const KMat<T,N,N> &a ) {
+        static_assert( N == 3, "ComputeClosed is only for 3x3" );
+
+        const double a00 = a(0,0), a11 = a(1,1), a22 = a(2,2);
+        const double a01 = a(0,1), a02 = a(0,2), a12 = a(1,2);
+        const double p1 = a01 * a01 + a02 * a02 + a12 * a12;
+        const double q = (a00 + a11 + a22) / 3;
+        const double p2 = (a00 - q) * (a00 - q) + (a11 - q) * (a11 - q) + (a22 - q) * (a22 - q) + 2 * p1;
+        const double p = std::sqrt(p2 / 6);
+
+        m_sweeps = 0;
+        InitVectors();
+        if( !(p > 0) ) {
+            for( int i=0; i<3; ++i ) m_w(i) = T(q);
+            return;
+        }
+
+        // B = (A - qI) / p, r = det(B) / 2
+        const double b00 = (a00 - q) / p, b11 = (a11 - q) / p, b22 = (a22 - q) / p;
+        const double b01 = a01 / p, b02 = a02 / p, b12 = a12 / p;
+        double r = ( b00 * (b11 * b22 - b12 * b12) - b01 * (b01 * b22 - b12 * b02) + b02 * (b01 * b12 - b11 * b02) ) / 2;
+        if( r < -1 ) r = -1;
+        if( r > 1 ) r = 1;
+        const double phi = std::acos(r) / 3;
+        const double pi = 3.14159265358979323846;
+
+        // e0 <= e1 <= e2
+        const double e2 = q + 2 * p * std::cos(phi);
+        const double e0 = q + 2 * p * std::cos(phi + 2 * pi / 3);
+        const double e1 = std::min( std::max( 3 * q - e0 - e2, e0 ), e2 );
+        m_w(0) = T(e0); m_w(1) = T(e1); m_w(2) = T(e2);
+
+        // 離れている方の端の固有値から固有ベクトルを作る
+        const bool top = (e2 - e1) > (e1 - e0);
+        const int ia = top ? 2 : 0, ib = top ? 0 : 2;
+        double va[3], vb[3], vm[3];
+        if( !Detail::EigVec3<T>(a, m_w(ia), va) ) {
+            // 固有ベクトルが決まらないときは Jacobi 法でやり直す ( 単位行列のままでは A V = V diag(w) にならない )
+            Compute(a);
+            return;
+        }
+        if( Detail::EigVec3<T>(a, m_w(ib), vb) ) {
+            const double d = va[0] * vb[0] + va[1] * vb[1] + va[2] * vb[2];
+            for( int i=0; i<3; ++i ) vb[i] -= d * va[i];
+            const double inv = 1.0 / std::sqrt(vb[0] * vb[0] + vb[1] * vb[1] + vb[2] * vb[2]);
+            for( int i=0; i<3; ++i ) vb[i] *= inv;
+        } else {
+            Detail::Orthogonal3( va, vb );
+        }
+        // 右手系になるように真ん中を決める ( v0 x v1 = v2 )
+        if( top ) Detail::Cross3( va, vb, vm );
+        else      Detail::Cross3( vb, va, vm );
+
+        for( int i=0; i<3; ++i ) {
+            m_v(i,ia) = T(va[i]);
+            m_v(i,ib) = T(vb[i]);
+            m_v(i,1)  = T(vm[i]);
+        }
+    }
+
+    /// 固有値 ( 昇順 )
+    const KVec<T,N> & Values() const {
+        return m_w;
+    }
+
+    /// 固有ベクトル ( 列 )
+    const KMat<T,N,N> & Vectors() const {
+        return m_v;
+    }
+
+    /// 実際に回した巡回数
+    int Sweeps() const {
+        return m_sweeps;
+    }
+
+private:
+    void InitVectors() {
+        for( int i=0; i<N; ++i ) for( int j=0; j<N; ++j ) m_v(i,j) = (i == j) ? T(1) : T();
+    }
+
+    // 昇順に並べて V の列も入れ替える
+    void Sort() {
+        for( int i=0; i<N-1; ++i ) {
+            int k = i;
+            for( int j=i+1; j<N; ++j ) if( m_w(j) < m_w(k) ) k = j;
+            if( k == i ) continue;
+            std::swap( m_w(i), m_w(k) );
+            for( int r=0; r<N; ++r ) std::swap( m_v(r,i), m_v(r,k) );
+        }
+    }
+
+private:
+    KVec<T,N>   m_w;
+    KMat<T,N,N> m_v;
+    int         m_sweeps;
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+/// eigen_sym
+template<class T, int N>
+KSymEigen<T,N> eigen_sym( const KMat<T,N,N> &a, bool vectors = true ) {
+    return KSymEigen<T,N>(a, vectors);
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 対称行列の束の固有値分解 ( 巡回 Jacobi 法 )
+/// 回転の係数も更新も束の方向に回すので分岐なしでベクトル化される
+/// sweeps > 0 なら固定回数，0 なら全ての行列が収束するまで ( 上限 KSymEigen::MAX_SWEEPS )
+/// v を 0 にすると固有ベクトルは計算しない．固有値は昇順．回した巡回数を返す
+template<class T, int N, int B>
+int eigen_sym_batch( const KMatBatch<T,N,N,B> &a, KVecBatch<T,N,B> &w, KMatBatch<T,N,N,B> *v, int sweeps = 0 ) {
+
+    KMatBatch<T,N,N,B> d(a);
+    if( v ) {
+        for( int i=0; i<N; ++i ) for( int j=0; j<N; ++j ) {
+            T *vl = v->Lane(i,j);
+            for( int b=0; b<B; ++b ) vl[b] = (i == j) ? T(1) : T();
+        }
+    }
+
+    T tol[B];
+    const T eps = std::numeric_limits<T>::epsilon();
+    for( int b=0; b<B; ++b ) {
+        T fro2 = T();
+        for( int i=0; i<N; ++i ) for( int j=0; j<N; ++j ) fro2 += a(i,j,b) * a(i,j,b);
+        tol[b] = eps * eps * fro2;
+    }
+
+    const int maxSweeps = sweeps > 0 ? sweeps : KSymEigen<T,N>::MAX_SWEEPS;
+    int done = 0;
+    for( ; done < maxSweeps; ++done ) {
+        if( sweeps <= 0 ) {
+            bool conv = true;
+            for( int b=0; b<B; ++b ) {
+                T off = T();
+                for( int p=0; p<N; ++p ) for( int q=p+1; q<N; ++q ) off += d(p,q,b) * d(p,q,b);
+                if( off > tol[b] ) conv = false;
+            }
+            if( conv ) break;
+        }
+
+        for( int p=0; p<N-1; ++p ) for( int q=p+1; q<N; ++q ) {
+            T c[B], s[B];
+            T *app = d.Lane(p,p), *aqq = d.Lane(q,q), *apq = d.Lane(p,q), *aqp = d.Lane(q,p);
+            for( int b=0; b<B; ++b ) {
+                T t;
+                Detail::JacobiCoef( app[b], aqq[b], apq[b], c[b], s[b], t );
+                app[b] -= t * apq[b];
+                aqq[b] += t * apq[b];
+                apq[b] = aqp[b] = T();
+            }
+            for( int k=0; k<N; ++k ) {
+                if( k == p || k == q ) continue;
+                T *akp = d.Lane(k,p), *akq = d.Lane(k,q), *apk = d.Lane(p,k), *aqk = d.Lane(q,k);
+                for( int b=0; b<B; ++b ) {
+                    const T x = akp[b], y = akq[b];
+                    akp[b] = apk[b] = c[b] * x - s[b] * y;
+                    akq[b] = aqk[b] = s[b] * x + c[b] * y;
+                }
+            }
+            if( v ) {
+                for( int k=0; k<N; ++k ) {
+                    T *vkp = v->Lane(k,p), *vkq = v->Lane(k,q);
+                    for( int b=0; b<B; ++b ) {
+                        const T x = vkp[b], y = vkq[b];
+                        vkp[b] = c[b] * x - s[b] * y;
+                        vkq[b] = s[b] * x + c[b] * y;
+                    }
+                }
+            }
+        }
+    }
+
+    for( int i=0; i<N; ++i ) {
+        T *wl = w.Lane(i);
+        const T *dl = d.Lane(i,i);
+        for( int b=0; b<B; ++b ) wl[b] = dl[b];
+    }
+
+    // 比較交換で昇順に並べる ( 選択による分岐なし )
+    for( int i=0; i<N-1; ++i ) for( int j=i+1; j<N; ++j ) {
+        T *wi = w.Lane(i), *wj = w.Lane(j);
+        bool sw[B];
+        for( int b=0; b<B; ++b ) {
+            sw[b] = wj[b] < wi[b];
+            const T x = wi[b], y = wj[b];
+            wi[b] = sw[b] ? y : x;
+            wj[b] = sw[b] ? x : y;
+        }
+        if( v ) {
+            for( int r=0; r<N; ++r ) {
+                T *vi = v->Lane(r,i), *vj = v->Lane(r,j);
+                for( int b=0; b<B; ++b ) {
+                    const T x = vi[b], y = vj[b];
+                    vi[b] = sw[b] ? y : x;
+                    vj[b] = sw[b] ? x : y;
+                }
+            }
+        }
+    }
+    return done;
+}
+
+} // namespace kblas
+
+/////////////////////////////////////////////////////////////////////////////
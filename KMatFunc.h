@@ -0,0 +1,584 @@
+﻿/////////////////////////////////////////////////////////////////////////////
+/** @file
+    @brief  行列関数 ( 指数関数，平方根，対数，極分解 )
+    @author oniprog
+*/
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cmath>
+#include <limits>
+
+#include "KMat.h"
+#include "KMatBatch.h"
+#include "KMatInv.h"
+#include "KMatLU.h"
+
+namespace kblas {
+
+namespace Detail {
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 小さな補助
+
+    // r += c A
+    template<class T, int N>
+    void AddScaled( KMat<T,N,N> &r, const T &c, const KMat<T,N,N> &a ) {
+        for( int i=0; i<N; ++i ) for( int j=0; j<N; ++j ) r(i,j) += c * a(i,j);
+    }
+
+    // r += c I
+    template<class T, int N>
+    void AddIdentity( KMat<T,N,N> &r, const T &c ) {
+        for( int i=0; i<N; ++i ) r(i,i) += c;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // Pade 近似の係数と，その次数を使ってよい 1 ノルムの上限 ( Higham 2005 )
+    template<class T>
+    struct PadeTheta;
+
+    template<>
+    struct PadeTheta<double> {
+        static const int COUNT = 5;
+        static int Degree( int i ) { static const int m[] = { 3, 5, 7, 9, 13 }; return m[i]; }
+        static double Theta( int i ) {
+            static const double t[] = { 1.495585217958292e-2, 2.539398330063230e-1, 9.504178996162932e-1,
+                                        2.097847961257068e0,  5.371920351148152e0 };
+            return t[i];
+        }
+    };
+
+    template<>
+    struct PadeTheta<float> {
+        static const int COUNT = 3;
+        static int Degree( int i ) { static const int m[] = { 3, 5, 7 }; return m[i]; }
+        static float Theta( int i ) {
+            static const float t[] = { 4.258730016922831e-1f, 1.880152677804762e0f, 3.925724783138660e0f };
+            return t[i];
+        }
+    };
+
+    inline const double * PadeCoef( int m ) {
+        static const double b3[]  = { 120, 60, 12, 1 };
+        static const double b5[]  = { 30240, 15120, 3360, 420, 30, 1 };
+        static const double b7[]  = { 17297280, 8648640, 1995840, 277200, 25200, 1512, 56, 1 };
+        static const double b9[]  = { 17643225600., 8821612800., 2075673600., 302702400., 30270240.,
+                                      2162160., 110880., 3960., 90., 1. };
+        static const double b13[] = { 64764752532480000., 32382376266240000., 7771770303897600.,
+                                      1187353796428800., 129060195264000., 10559470521600.,
+                                      670442572800., 33522128640., 1323241920., 40840800.,
+                                      960960., 16380., 182., 1. };
+        switch( m ) {
+        case 3: return b3;
+        case 5: return b5;
+        case 7: return b7;
+        case 9: return b9;
+        default: return b13;
+        }
+    }
+
+    // (V - U)^{-1} (V + U) を解く．N <= 4 は閉じた式の逆行列を使う
+    template<class T, int N, bool SMALL>
+    struct PadeSolveImpl {
+        static KMat<T,N,N> f( const KMat<T,N,N> &p, const KMat<T,N,N> &q ) {
+            return KLU<T,N>(q).Solve(p);
+        }
+    };
+
+    template<class T, int N>
+    struct PadeSolveImpl<T,N,true> {
+        static KMat<T,N,N> f( const KMat<T,N,N> &p, const KMat<T,N,N> &q ) {
+            return prod( inverse(q), p );
+        }
+    };
+
+    template<class T, int N>
+    KMat<T,N,N> PadeSolve( const KMat<T,N,N> &p, const KMat<T,N,N> &q ) {
+        return PadeSolveImpl<T,N,(N <= 4)>::f(p, q);
+    }
+
+    // 逆行列と行列式．N <= 4 は閉じた式，それ以上は LU
+    template<class T, int N, bool SMALL>
+    struct InvDetImpl {
+        static T f( const KMat<T,N,N> &a, KMat<T,N,N> &inv ) {
+            const KLU<T,N> lf(a);
+            if( !lf.IsOk() ) return T(0);
+            inv = lf.Inverse();
+            return lf.Det();
+        }
+    };
+
+    template<class T, int N>
+    struct InvDetImpl<T,N,true> {
+        static T f( const KMat<T,N,N> &a, KMat<T,N,N> &inv ) {
+            return InvKMat<T,N>::f(a, inv);
+        }
+    };
+
+    template<class T, int N>
+    T InvDet( const KMat<T,N,N> &a, KMat<T,N,N> &inv ) {
+        return InvDetImpl<T,N,(N <= 4)>::f(a, inv);
+    }
+
+    // 次数 m の Pade 近似 r_m(A)
+    template<class T, int N>
+    KMat<T,N,N> Pade( const KMat<T,N,N> &a, int m ) {
+        const double *b = PadeCoef(m);
+        const KMat<T,N,N> a2 = prod(a, a);
+        KMat<T,N,N> ui(T(0)), v(T(0));
+
+        if( m == 13 ) {
+            const KMat<T,N,N> a4 = prod(a2, a2);
+            const KMat<T,N,N> a6 = prod(a4, a2);
+            KMat<T,N,N> uh(T(0)), vh(T(0));
+            AddScaled( uh, T(b[13]), a6 );  AddScaled( uh, T(b[11]), a4 );  AddScaled( uh, T(b[9]), a2 );
+            AddScaled( vh, T(b[12]), a6 );  AddScaled( vh, T(b[10]), a4 );  AddScaled( vh, T(b[8]), a2 );
+            ui = prod(a6, uh);
+            v  = prod(a6, vh);
+            AddScaled( ui, T(b[7]), a6 );   AddScaled( ui, T(b[5]), a4 );   AddScaled( ui, T(b[3]), a2 );
+            AddScaled( v,  T(b[6]), a6 );   AddScaled( v,  T(b[4]), a4 );   AddScaled( v,  T(b[2]), a2 );
+        } else {
+            // 偶数次のべきを順に作る
+            AddScaled( ui, T(b[3]), a2 );
+            AddScaled( v,  T(b[2]), a2 );
+            KMat<T,N,N> ak(a2);
+            for( int k=4; k<=m; k+=2 ) {
+                ak = prod(ak, a2);
+                AddScaled( ui, T(b[k+1]), ak );
+                AddScaled( v,  T(b[k]),   ak );
+            }
+        }
+        AddIdentity( ui, T(b[1]) );
+        AddIdentity( v,  T(b[0]) );
+        const KMat<T,N,N> u = prod(a, ui);
+
+        KMat<T,N,N> p(v), q(v);
+        for( int i=0; i<N; ++i ) for( int j=0; j<N; ++j ) {
+            p(i,j) += u(i,j);
+            q(i,j) -= u(i,j);
+        }
+        return PadeSolve<T,N>(p, q);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 一般の N
+    template<class T, int N>
+    struct Expm {
+        static KMat<T,N,N> f( const KMat<T,N,N> &a ) {
+            const T norm = Norm1(a);
+            const int last = PadeTheta<T>::COUNT - 1;
+            for( int i=0; i<last; ++i ) {
+                if( norm <= PadeTheta<T>::Theta(i) ) return Pade<T,N>( a, PadeTheta<T>::Degree(i) );
+            }
+
+            // 2^-s A のノルムが最大次数の範囲に入るまで縮めて，s 回二乗する
+            int s = 0;
+            if( norm > PadeTheta<T>::Theta(last) ) {
+                s = int( std::ceil( std::log( double(norm / PadeTheta<T>::Theta(last)) ) / std::log(2.0) ) );
+                if( s < 0 ) s = 0;
+            }
+            KMat<T,N,N> as(a);
+            const T scale = T( std::ldexp(1.0, -s) );
+            for( int i=0; i<N; ++i ) for( int j=0; j<N; ++j ) as(i,j) *= scale;
+
+            KMat<T,N,N> r = Pade<T,N>( as, PadeTheta<T>::Degree(last) );
+            for( int i=0; i<s; ++i ) r = prod(r, r);
+            return r;
+        }
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // |A - I|_1
+    template<class T, int N>
+    T DistIdentity( const KMat<T,N,N> &a ) {
+        T r = T();
+        for( int j=0; j<N; ++j ) {
+            T s = T();
+            for( int i=0; i<N; ++i ) s += std::abs( a(i,j) - (i == j ? T(1) : T(0)) );
+            if( s > r ) r = s;
+        }
+        return r;
+    }
+
+    // 行列式でスケーリングした Denman-Beavers 反復 ( 積の形，Higham 2008 (6.29) )
+    //   M_{k+1} = ( I + (mu^2 M + mu^-2 M^-1) / 2 ) / 2
+    //   Y_{k+1} = mu Y ( I + mu^-2 M^-1 ) / 2,   M_0 = Y_0 = A
+    // Y は A^{1/2} に，M は I に収束する．1 回の反復で逆行列は 1 つ
+    template<class T, int N>
+    bool SqrtDB( const KMat<T,N,N> &a, KMat<T,N,N> &y, int maxIter, int *iterations ) {
+        const T eps = std::numeric_limits<T>::epsilon();
+        const T tol = N * eps;
+        KMat<T,N,N> m(a), mi;
+        y = a;
+        T prev = DistIdentity(m);
+        bool scaling = true;
+        for( int k=0; k<maxIter; ++k ) {
+            const T d = InvDet(m, mi);
+            if( !(d == d) || d == T(0) ) return false;
+
+            // M が I に近づいたらスケーリングはやめる ( 二次収束を崩さない )
+            const T mu = scaling ? T( std::pow( double(std::abs(d)), -0.5 / N ) ) : T(1);
+            const T mu2 = mu * mu, imu2 = T(1) / mu2;
+
+            KMat<T,N,N> w(mi);
+            for( int i=0; i<N; ++i ) for( int j=0; j<N; ++j ) w(i,j) *= imu2;
+            AddIdentity( w, T(1) );
+            y = prod(y, w);
+            for( int i=0; i<N; ++i ) for( int j=0; j<N; ++j ) {
+                y(i,j) *= mu / 2;
+                m(i,j) = (mu2 * m(i,j) + imu2 * mi(i,j)) / 4;
+            }
+            AddIdentity( m, T(0.5) );
+
+            const T dist = DistIdentity(m);
+            if( iterations ) *iterations = k + 1;
+            if( !(dist == dist) ) return false;
+            if( dist <= tol ) return true;
+            // 丸め誤差で下げ止まった
+            if( dist < std::sqrt(eps) && dist >= prev ) return true;
+            if( dist < T(1E-2) ) scaling = false;
+            prev = dist;
+        }
+        return false;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 8 点 Gauss-Legendre ( [0,1] ) の節点と重み
+    // log(I + X) = \int_0^1 X (I + t X)^{-1} dt を [8/8] の Pade 近似 ( 部分分数 ) で求める
+    inline double LogNode( int i ) {
+        static const double t[] = { 0.0198550717512319, 0.1016667612931866, 0.2372337950418355, 0.4082826787521751,
+                                    0.5917173212478249, 0.7627662049581645, 0.8983332387068134, 0.9801449282487681 };
+        return t[i];
+    }
+    inline double LogWeight( int i ) {
+        static const double w[] = { 0.0506142681451881, 0.1111905172266872, 0.1568533229389436, 0.1813418916891810,
+                                    0.1813418916891810, 0.1568533229389436, 0.1111905172266872, 0.0506142681451881 };
+        return w[i];
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // Newton-Schulz の 1 ステップ X <- X (3 I - X^T X) / 2 ( 積だけ )．変化の 1 ノルムを返す
+    template<class T, int N>
+    T NewtonSchulzStep( KMat<T,N,N> &x ) {
+        KMat<T,N,N> g = prod( trans(x), x );
+        for( int i=0; i<N; ++i ) for( int j=0; j<N; ++j ) g(i,j) = (i == j ? T(1.5) : T(0)) - g(i,j) / 2;
+        const KMat<T,N,N> r = prod(x, g);
+        T dn = T();
+        for( int j=0; j<N; ++j ) {
+            T s = T();
+            for( int i=0; i<N; ++i ) s += std::abs( r(i,j) - x(i,j) );
+            if( s > dn ) dn = s;
+        }
+        x = r;
+        return dn;
+    }
+
+    // Newton-Schulz は特異値が (0, sqrt(3)) にあるときに収束する
+    // sqrt(|A|_1 |A|_inf) >= |A|_2 がはみ出しそうなときだけ割る ( 回転に近い行列はそのまま )
+    template<class T, int N>
+    T PolarScale( const KMat<T,N,N> &a ) {
+        T ninf = T();
+        for( int i=0; i<N; ++i ) {
+            T s = T();
+            for( int j=0; j<N; ++j ) s += std::abs(a(i,j));
+            if( s > ninf ) ninf = s;
+        }
+        const T bound = std::sqrt( Norm1(a) * ninf );
+        return bound >= T(1.7) ? T(1) / bound : T(1);
+    }
+
+    // 2x2 は閉じた式．A = m I + B ( B のトレースは 0 ) とすると B^2 = d I なので
+    // exp(A) = e^m ( cosh(sqrt(d)) I + sinh(sqrt(d)) / sqrt(d) B )
+    template<class T>
+    struct Expm<T,2> {
+        static KMat<T,2,2> f( const KMat<T,2,2> &a ) {
+            const T m = (a(0,0) + a(1,1)) / 2;
+            const T h = (a(0,0) - a(1,1)) / 2;
+            const T d = h * h + a(0,1) * a(1,0);
+            const T r = std::sqrt(std::abs(d));
+
+            T c, s;   // c = cosh(sqrt(d)), s = sinh(sqrt(d)) / sqrt(d) ( d < 0 なら cos, sin )
+            if( r < T(1E-4) ) {
+                c = T(1) + d / 2 + d * d / 24;
+                s = T(1) + d / 6 + d * d / 120;
+            } else if( d > T() ) {
+                c = std::cosh(r);
+                s = std::sinh(r) / r;
+            } else {
+                c = std::cos(r);
+                s = std::sin(r) / r;
+            }
+
+            const T e = std::exp(m);
+            KMat<T,2,2> ret;
+            ret(0,0) = e * (c + s * h);
+            ret(0,1) = e * s * a(0,1);
+            ret(1,0) = e * s * a(1,0);
+            ret(1,1) = e * (c - s * h);
+            return ret;
+        }
+    };
+
+    // 3x3 は次数 7 に固定した Pade 近似 ( 次数の選択や偶数次のべきのループがない )
+    // |A|_1 が次数 7 の上限を超える分はスケーリングと二乗で補い，(V - U)^{-1} は閉じた式で求める
+    template<class T>
+    struct Expm<T,3> {
+        static KMat<T,3,3> f( const KMat<T,3,3> &a ) {
+            const int deg = 2;     // PadeTheta の次数 7 の位置
+            const T theta = PadeTheta<T>::Theta(deg);
+            const T norm = Norm1(a);
+            int s = 0;
+            if( norm > theta ) {
+                s = int( std::ceil( std::log( double(norm / theta) ) / std::log(2.0) ) );
+                if( s < 0 ) s = 0;
+            }
+            KMat<T,3,3> as(a);
+            const T scale = T( std::ldexp(1.0, -s) );
+            for( int i=0; i<3; ++i ) for( int j=0; j<3; ++j ) as(i,j) *= scale;
+
+            const double *b = PadeCoef(7);
+            const KMat<T,3,3> a2 = prod(as, as);
+            const KMat<T,3,3> a4 = prod(a2, a2);
+            const KMat<T,3,3> a6 = prod(a4, a2);
+            KMat<T,3,3> ui, v;
+            for( int i=0; i<3; ++i ) for( int j=0; j<3; ++j ) {
+                const T d = i == j ? T(1) : T(0);
+                ui(i,j) = T(b[7]) * a6(i,j) + T(b[5]) * a4(i,j) + T(b[3]) * a2(i,j) + T(b[1]) * d;
+                v(i,j)  = T(b[6]) * a6(i,j) + T(b[4]) * a4(i,j) + T(b[2]) * a2(i,j) + T(b[0]) * d;
+            }
+            const KMat<T,3,3> u = prod(as, ui);
+
+            KMat<T,3,3> p, q, qi;
+            for( int i=0; i<3; ++i ) for( int j=0; j<3; ++j ) {
+                p(i,j) = v(i,j) + u(i,j);
+                q(i,j) = v(i,j) - u(i,j);
+            }
+            ClosedInv<T,3>::Inverse(q, qi);
+            KMat<T,3,3> r = prod(qi, p);
+            for( int i=0; i<s; ++i ) r = prod(r, r);
+            return r;
+        }
+    };
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 行列の指数関数 exp(A)
+/// ノルムから Pade 近似の次数を選び，足りなければスケーリングと二乗を使う ( Higham 2005 )
+/// 2x2 は閉じた式，3x3 は次数 7 に固定した Pade 近似
+/// N <= 4 の線形方程式は閉じた式の逆行列，それ以上は LU で解く
+template<class T, int N>
+KMat<T,N,N> expm( const KMat<T,N,N> &a ) {
+    return Detail::Expm<T,N>::f(a);
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// exp(A) v を行列を作らずに求める
+/// exp(A) v = ( exp(A/s) )^s v とし，各段は Taylor 級数を行列ベクトル積だけで足す
+/// ( Al-Mohy & Higham の方法を簡単にしたもの．s は |A|_1 から決める )
+template<class T, int N>
+KVec<T,N> expm_multiply( const KMat<T,N,N> &a, const KVec<T,N> &v ) {
+    const T norm = Detail::Norm1(a);
+    int s = int( std::ceil( double(norm) ) );
+    if( s < 1 ) s = 1;
+
+    KMat<T,N,N> as(a);
+    const T scale = T(1) / T(s);
+    for( int i=0; i<N; ++i ) for( int j=0; j<N; ++j ) as(i,j) *= scale;
+
+    const T eps = std::numeric_limits<T>::epsilon();
+    const int maxTerms = 60;
+    KVec<T,N> f(v);
+    for( int i=0; i<s; ++i ) {
+        KVec<T,N> term(f);
+        const T fn = Detail::Norm1(f);
+        for( int k=1; k<=maxTerms; ++k ) {
+            term = prod(as, term);
+            const T inv = T(1) / T(k);
+            for( int j=0; j<N; ++j ) {
+                term(j) *= inv;
+                f(j) += term(j);
+            }
+            if( Detail::Norm1(term) <= eps * fn ) break;
+        }
+    }
+    return f;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 行列の平方根 A^{1/2} ( 主平方根 )
+/// 行列式でスケーリングした Denman-Beavers 反復．作業領域はすべてスタックに置く
+/// 負の実数の固有値があるなど実数の主平方根がないときや，反復が収束しないときは
+/// ok に false を入れる ( 戻り値は途中の値 )
+template<class T, int N>
+KMat<T,N,N> sqrtm( const KMat<T,N,N> &a, bool *ok = 0, int maxIter = 50, int *iterations = 0 ) {
+    KMat<T,N,N> y;
+    const bool f = Detail::SqrtDB( a, y, maxIter, iterations );
+    if( ok ) *ok = f;
+    return y;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 行列の対数 log(A) ( 主対数 )
+/// 逆スケーリングと二乗: |A^{1/2^s} - I|_1 <= 1/4 になるまで平方根を取り，
+/// log(I + X) を部分分数の [8/8] Pade 近似で求めて 2^s 倍する ( Higham 2008 11.5 )
+/// 主対数がない ( 負の実数の固有値がある ) ときは ok に false を入れる
+template<class T, int N>
+KMat<T,N,N> logm( const KMat<T,N,N> &a, bool *ok = 0 ) {
+    const int maxRoots = 60;
+    KMat<T,N,N> x(a);
+    int s = 0;
+    bool f = true;
+    while( f && Detail::DistIdentity(x) > T(0.25) ) {
+        if( s == maxRoots ) { f = false; break; }
+        f = Detail::SqrtDB( KMat<T,N,N>(x), x, 50, 0 );
+        ++s;
+    }
+
+    KMat<T,N,N> r(T(0));
+    if( f ) {
+        Detail::AddIdentity( x, T(-1) );
+        for( int k=0; k<8; ++k ) {
+            KMat<T,N,N> q(x);
+            for( int i=0; i<N; ++i ) for( int j=0; j<N; ++j ) q(i,j) *= T(Detail::LogNode(k));
+            Detail::AddIdentity( q, T(1) );
+            Detail::AddScaled( r, T(Detail::LogWeight(k)), Detail::PadeSolve<T,N>(x, q) );
+        }
+        const T scale = T( std::ldexp(1.0, s) );
+        for( int i=0; i<N; ++i ) for( int j=0; j<N; ++j ) r(i,j) *= scale;
+    }
+    if( ok ) *ok = f;
+    return r;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 極分解 A = U H ( U は直交，H は対称半正定値 )
+/// Newton-Schulz 反復 X <- X (3 I - X^T X) / 2 なので逆行列を使わず prod だけで済む
+/// 特異値が 0 に近いと収束が遅い．maxIter 回で収束しなければ false を返す ( u は途中の値 )
+/// h を渡すと H = U^T A ( 対称化したもの ) を入れる
+template<class T, int N>
+bool polar( const KMat<T,N,N> &a, KMat<T,N,N> &u, KMat<T,N,N> *h = 0, int maxIter = 100 ) {
+    const T eps = std::numeric_limits<T>::epsilon();
+    KMat<T,N,N> x(a);
+    const T sc = Detail::PolarScale(a);
+    for( int i=0; i<N; ++i ) for( int j=0; j<N; ++j ) x(i,j) *= sc;
+
+    // 変化が sqrt(eps) を切ったら，二次収束なのでもう 1 回で eps に届く
+    bool conv = false;
+    for( int k=0; k<maxIter; ++k ) {
+        const T d = Detail::NewtonSchulzStep(x);
+        if( !(d == d) ) break;
+        if( d <= std::sqrt(eps) ) {
+            Detail::NewtonSchulzStep(x);
+            conv = true;
+            break;
+        }
+    }
+    u = x;
+    if( h ) {
+        const KMat<T,N,N> p = prod( trans(x), a );
+        for( int i=0; i<N; ++i ) for( int j=0; j<N; ++j ) (*h)(i,j) = (p(i,j) + p(j,i)) / 2;
+    }
+    return conv;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// ずれた回転行列を直交に戻す ( Newton-Schulz を steps 回，スケーリングなし )
+/// 誤差 |R^T R - I| が e なら 1 回で O(e^2) になる．行列式の符号は変わらない
+template<class T, int N>
+void orthonormalize( KMat<T,N,N> &r, int steps = 2 ) {
+    for( int k=0; k<steps; ++k ) Detail::NewtonSchulzStep(r);
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 束ごとに sqrtm / logm を求める．ok[b] に成功したかを入れ ( 0 なら入れない )，成功した個数を返す
+/// 反復回数が行列ごとに違うので 1 本ずつ求める
+template<class T, int N, int B>
+int sqrtm_batch( const KMatBatch<T,N,N,B> &a, KMatBatch<T,N,N,B> &r, bool *ok = 0 ) {
+    int count = 0;
+    for( int l=0; l<B; ++l ) {
+        bool f;
+        r.Set( l, sqrtm( a.Get(l), &f ) );
+        if( ok ) ok[l] = f;
+        if( f ) ++count;
+    }
+    return count;
+}
+
+template<class T, int N, int B>
+int logm_batch( const KMatBatch<T,N,N,B> &a, KMatBatch<T,N,N,B> &r, bool *ok = 0 ) {
+    int count = 0;
+    for( int l=0; l<B; ++l ) {
+        bool f;
+        r.Set( l, logm( a.Get(l), &f ) );
+        if( ok ) ok[l] = f;
+        if( f ) ++count;
+    }
+    return count;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 極分解の直交因子 ( 束 )．Newton-Schulz は積だけなので束の方向が一番内側で分岐がない
+/// すべての行列の変化が sqrt(eps) を切ったらもう 1 回回して止める．収束したら true
+template<class T, int N, int B>
+bool polar_batch( const KMatBatch<T,N,N,B> &a, KMatBatch<T,N,N,B> &u, int maxIter = 100 ) {
+    const T eps = std::numeric_limits<T>::epsilon();
+    u = a;
+    for( int l=0; l<B; ++l ) {
+        const T sc = Detail::PolarScale( a.Get(l) );
+        for( int i=0; i<N; ++i ) for( int j=0; j<N; ++j ) u(i,j,l) *= sc;
+    }
+
+    bool last = false;
+    for( int k=0; k<maxIter; ++k ) {
+        // G = 3/2 I - X^T X / 2
+        KMatBatch<T,N,N,B> g;
+        for( int i=0; i<N; ++i ) for( int j=i; j<N; ++j ) {
+            T s[B];
+            for( int b=0; b<B; ++b ) s[b] = T();
+            for( int p=0; p<N; ++p ) {
+                const T *xi = u.Lane(p,i);
+                const T *xj = u.Lane(p,j);
+                for( int b=0; b<B; ++b ) s[b] += xi[b] * xj[b];
+            }
+            T *gij = g.Lane(i,j);
+            T *gji = g.Lane(j,i);
+            const T c = i == j ? T(1.5) : T(0);
+            for( int b=0; b<B; ++b ) {
+                gij[b] = c - s[b] / 2;
+                gji[b] = gij[b];
+            }
+        }
+
+        // X <- X G．変化の大きさは全要素の最大で見る
+        T dmax = T();
+        for( int i=0; i<N; ++i ) {
+            T r[N][B];
+            for( int j=0; j<N; ++j ) {
+                for( int b=0; b<B; ++b ) r[j][b] = T();
+                for( int p=0; p<N; ++p ) {
+                    const T *xp = u.Lane(i,p);
+                    const T *gp = g.Lane(p,j);
+                    for( int b=0; b<B; ++b ) r[j][b] += xp[b] * gp[b];
+                }
+            }
+            for( int j=0; j<N; ++j ) {
+                T *xj = u.Lane(i,j);
+                for( int b=0; b<B; ++b ) {
+                    const T d = std::abs( r[j][b] - xj[b] );
+                    dmax = d > dmax ? d : dmax;
+                    xj[b] = r[j][b];
+                }
+            }
+        }
+        if( last ) return true;
+        if( !(dmax == dmax) ) return false;
+        if( N * dmax <= std::sqrt(eps) ) last = true;
+    }
+    return false;
+}
+
+} // namespace kblas
+
+/////////////////////////////////////////////////////////////////////////////
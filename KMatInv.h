@@ -0,0 +1,351 @@
+﻿/////////////////////////////////////////////////////////////////////////////
+/** @file
+    @brief  2x2, 3x3, 4x4 行列の行列式と逆行列 ( 余因子による閉じた式 )
+    @author oniprog
+*/
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "KMat.h"
+#include "KMatBatch.h"
+
+namespace kblas {
+
+namespace Detail {
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 閉じた式による行列式と逆行列
+    // MA, MB は (i,j) で要素を返すもの ( KMat, BatchLane )
+    // Inverse は行列式を返す．行列式が 0 のときの r は不定
+    template<class T, int N>
+    struct ClosedInv {
+        static_assert( N >= 1 && N <= 4, "closed form inverse is only for N <= 4" );
+    };
+
+    template<class T>
+    struct ClosedInv<T,1> {
+        template<class MA>
+        static T Det( const MA &a ) {
+            return a(0,0);
+        }
+
+        template<class MA, class MB>
+        static T Inverse( const MA &a, MB &r ) {
+            const T d = a(0,0);
+            r(0,0) = T(1) / d;
+            return d;
+        }
+    };
+
+    template<class T>
+    struct ClosedInv<T,2> {
+        template<class MA>
+        static T Det( const MA &a ) {
+            return a(0,0) * a(1,1) - a(0,1) * a(1,0);
+        }
+
+        template<class MA, class MB>
+        static T Inverse( const MA &a, MB &r ) {
+            const T a00 = a(0,0), a01 = a(0,1), a10 = a(1,0), a11 = a(1,1);
+            const T d = a00 * a11 - a01 * a10;
+            const T id = T(1) / d;
+            r(0,0) =  a11 * id;     r(0,1) = -a01 * id;
+            r(1,0) = -a10 * id;     r(1,1) =  a00 * id;
+            return d;
+        }
+    };
+
+    template<class T>
+    struct ClosedInv<T,3> {
+        template<class MA>
+        static T Det( const MA &a ) {
+            return a(0,0) * (a(1,1) * a(2,2) - a(1,2) * a(2,1))
+                 - a(0,1) * (a(1,0) * a(2,2) - a(1,2) * a(2,0))
+                 + a(0,2) * (a(1,0) * a(2,1) - a(1,1) * a(2,0));
+        }
+
+        template<class MA, class MB>
+        static T Inverse( const MA &a, MB &r ) {
+            const T a00 = a(0,0), a01 = a(0,1), a02 = a(0,2);
+            const T a10 = a(1,0), a11 = a(1,1), a12 = a(1,2);
+            const T a20 = a(2,0), a21 = a(2,1), a22 = a(2,2);
+
+            const T c00 = a11 * a22 - a12 * a21;
+            const T c10 = a12 * a20 - a10 * a22;
+            const T c20 = a10 * a21 - a11 * a20;
+            const T d = a00 * c00 + a01 * c10 + a02 * c20;
+            const T id = T(1) / d;
+
+            r(0,0) = c00 * id;
+            r(0,1) = (a02 * a21 - a01 * a22) * id;
+            r(0,2) = (a01 * a12 - a02 * a11) * id;
+            r(1,0) = c10 * id;
+            r(1,1) = (a00 * a22 - a02 * a20) * id;
+            r(1,2) = (a02 * a10 - a00 * a12) * id;
+            r(2,0) = c20 * id;
+            r(2,1) = (a01 * a20 - a00 * a21) * id;
+            r(2,2) = (a00 * a11 - a01 * a10) * id;
+            return d;
+        }
+    };
+
+    // 4x4 は上 2 行の 2x2 小行列式 s と下 2 行の 2x2 小行列式 c から作る
+    template<class T>
+    struct ClosedInv<T,4> {
+        template<class MA>
+        static T Det( const MA &a ) {
+            const T s0 = a(0,0) * a(1,1) - a(1,0) * a(0,1);
+            const T s1 = a(0,0) * a(1,2) - a(1,0) * a(0,2);
+            const T s2 = a(0,0) * a(1,3) - a(1,0) * a(0,3);
+            const T s3 = a(0,1) * a(1,2) - a(1,1) * a(0,2);
+            const T s4 = a(0,1) * a(1,3) - a(1,1) * a(0,3);
+            const T s5 = a(0,2) * a(1,3) - a(1,2) * a(0,3);
+
+            const T c5 = a(2,2) * a(3,3) - a(3,2) * a(2,3);
+            const T c4 = a(2,1) * a(3,3) - a(3,1) * a(2,3);
+            const T c3 = a(2,1) * a(3,2) - a(3,1) * a(2,2);
+            const T c2 = a(2,0) * a(3,3) - a(3,0) * a(2,3);
+            const T c1 = a(2,0) * a(3,2) - a(3,0) * a(2,2);
+            const T c0 = a(2,0) * a(3,1) - a(3,0) * a(2,1);
+
+            return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+        }
+
+        template<class MA, class MB>
+        static T Inverse( const MA &a, MB &r ) {
+            const T a00 = a(0,0), a01 = a(0,1), a02 = a(0,2), a03 = a(0,3);
+            const T a10 = a(1,0), a11 = a(1,1), a12 = a(1,2), a13 = a(1,3);
+            const T a20 = a(2,0), a21 = a(2,1), a22 = a(2,2), a23 = a(2,3);
+            const T a30 = a(3,0), a31 = a(3,1), a32 = a(3,2), a33 = a(3,3);
+
+            const T s0 = a00 * a11 - a10 * a01;
+            const T s1 = a00 * a12 - a10 * a02;
+            const T s2 = a00 * a13 - a10 * a03;
+            const T s3 = a01 * a12 - a11 * a02;
+            const T s4 = a01 * a13 - a11 * a03;
+            const T s5 = a02 * a13 - a12 * a03;
+
+            const T c5 = a22 * a33 - a32 * a23;
+            const T c4 = a21 * a33 - a31 * a23;
+            const T c3 = a21 * a32 - a31 * a22;
+            const T c2 = a20 * a33 - a30 * a23;
+            const T c1 = a20 * a32 - a30 * a22;
+            const T c0 = a20 * a31 - a30 * a21;
+
+            const T d = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+            const T id = T(1) / d;
+
+            r(0,0) = ( a11 * c5 - a12 * c4 + a13 * c3) * id;
+            r(0,1) = (-a01 * c5 + a02 * c4 - a03 * c3) * id;
+            r(0,2) = ( a31 * s5 - a32 * s4 + a33 * s3) * id;
+            r(0,3) = (-a21 * s5 + a22 * s4 - a23 * s3) * id;
+
+            r(1,0) = (-a10 * c5 + a12 * c2 - a13 * c1) * id;
+            r(1,1) = ( a00 * c5 - a02 * c2 + a03 * c1) * id;
+            r(1,2) = (-a30 * s5 + a32 * s2 - a33 * s1) * id;
+            r(1,3) = ( a20 * s5 - a22 * s2 + a23 * s1) * id;
+
+            r(2,0) = ( a10 * c4 - a11 * c2 + a13 * c0) * id;
+            r(2,1) = (-a00 * c4 + a01 * c2 - a03 * c0) * id;
+            r(2,2) = ( a30 * s4 - a31 * s2 + a33 * s0) * id;
+            r(2,3) = (-a20 * s4 + a21 * s2 - a23 * s0) * id;
+
+            r(3,0) = (-a10 * c3 + a11 * c1 - a12 * c0) * id;
+            r(3,1) = ( a00 * c3 - a01 * c1 + a02 * c0) * id;
+            r(3,2) = (-a30 * s3 + a31 * s1 - a32 * s0) * id;
+            r(3,3) = ( a20 * s3 - a21 * s1 + a22 * s0) * id;
+            return d;
+        }
+    };
+
+#ifdef KBLAS_USE_SSE
+    ///////////////////////////////////////////////////////////////////////////////////
+    // SSE による float 4x4 の逆行列
+    // 行 ra, rb の 2x2 小行列式から，余因子の列を作るための並びを作る
+    //   m1 = (x5,x5,x4,x3), m2 = (x4,x2,x2,x1), m3 = (x3,x1,x0,x0)
+    inline void Minors4Sse( __m128 ra, __m128 rb, __m128 &m1, __m128 &m2, __m128 &m3 ) {
+        // p = (x0,x1,x2,x3)
+        const __m128 p = _mm_sub_ps(
+            _mm_mul_ps( _mm_shuffle_ps(ra, ra, _MM_SHUFFLE(1,0,0,0)), _mm_shuffle_ps(rb, rb, _MM_SHUFFLE(2,3,2,1)) ),
+            _mm_mul_ps( _mm_shuffle_ps(rb, rb, _MM_SHUFFLE(1,0,0,0)), _mm_shuffle_ps(ra, ra, _MM_SHUFFLE(2,3,2,1)) ) );
+        // q = (x4,x5,x4,x5)
+        const __m128 q = _mm_sub_ps(
+            _mm_mul_ps( _mm_shuffle_ps(ra, ra, _MM_SHUFFLE(2,1,2,1)), _mm_shuffle_ps(rb, rb, _MM_SHUFFLE(3,3,3,3)) ),
+            _mm_mul_ps( _mm_shuffle_ps(rb, rb, _MM_SHUFFLE(2,1,2,1)), _mm_shuffle_ps(ra, ra, _MM_SHUFFLE(3,3,3,3)) ) );
+
+        m1 = _mm_shuffle_ps( q, _mm_shuffle_ps(q, p, _MM_SHUFFLE(3,3,0,0)), _MM_SHUFFLE(2,0,1,1) );
+        m2 = _mm_shuffle_ps( _mm_shuffle_ps(q, p, _MM_SHUFFLE(2,2,0,0)), p, _MM_SHUFFLE(1,2,2,0) );
+        m3 = _mm_shuffle_ps( p, p, _MM_SHUFFLE(0,0,1,3) );
+    }
+
+    // 余因子行列の 1 列 ( 符号は sign で反転 )
+    inline __m128 Cofactor4Sse( __m128 r, __m128 m1, __m128 m2, __m128 m3, __m128 sign ) {
+        __m128 c = _mm_mul_ps( _mm_shuffle_ps(r, r, _MM_SHUFFLE(0,0,0,1)), m1 );
+        c = _mm_sub_ps( c, _mm_mul_ps( _mm_shuffle_ps(r, r, _MM_SHUFFLE(1,1,2,2)), m2 ) );
+        c = _mm_add_ps( c, _mm_mul_ps( _mm_shuffle_ps(r, r, _MM_SHUFFLE(2,3,3,3)), m3 ) );
+        return _mm_xor_ps( c, sign );
+    }
+
+    // a, r は行優先の 16 要素．行列式を返す
+    inline float Inverse4Sse( const float *a, float *r ) {
+        const __m128 r0 = _mm_loadu_ps(a);
+        const __m128 r1 = _mm_loadu_ps(a+4);
+        const __m128 r2 = _mm_loadu_ps(a+8);
+        const __m128 r3 = _mm_loadu_ps(a+12);
+
+        __m128 s1, s2, s3, c1, c2, c3;
+        Minors4Sse( r0, r1, s1, s2, s3 );
+        Minors4Sse( r2, r3, c1, c2, c3 );
+
+        const __m128 pn = _mm_set_ps( -0.0f, 0.0f, -0.0f, 0.0f );
+        const __m128 np = _mm_set_ps( 0.0f, -0.0f, 0.0f, -0.0f );
+        __m128 col0 = Cofactor4Sse( r1, c1, c2, c3, pn );
+        __m128 col1 = Cofactor4Sse( r0, c1, c2, c3, np );
+        __m128 col2 = Cofactor4Sse( r3, s1, s2, s3, pn );
+        __m128 col3 = Cofactor4Sse( r2, s1, s2, s3, np );
+
+        // det = r0 . col0
+        __m128 d = _mm_mul_ps( r0, col0 );
+        d = _mm_add_ps( d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(2,3,0,1)) );
+        d = _mm_add_ps( d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(1,0,3,2)) );
+        const __m128 id = _mm_div_ps( _mm_set1_ps(1.0f), d );
+
+        col0 = _mm_mul_ps( col0, id );
+        col1 = _mm_mul_ps( col1, id );
+        col2 = _mm_mul_ps( col2, id );
+        col3 = _mm_mul_ps( col3, id );
+        _MM_TRANSPOSE4_PS( col0, col1, col2, col3 );
+        _mm_storeu_ps( r,    col0 );
+        _mm_storeu_ps( r+4,  col1 );
+        _mm_storeu_ps( r+8,  col2 );
+        _mm_storeu_ps( r+12, col3 );
+
+        return _mm_cvtss_f32(d);
+    }
+#endif
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // KMat の逆行列．float 4x4 だけ SSE に差し替える
+    template<class T, int N>
+    struct InvKMat {
+        static T f( const KMat<T,N,N> &a, KMat<T,N,N> &r ) {
+            return ClosedInv<T,N>::Inverse(a, r);
+        }
+    };
+
+#ifdef KBLAS_USE_SSE
+    template<>
+    struct InvKMat<float,4> {
+        static float f( const KMat<float,4,4> &a, KMat<float,4,4> &r ) {
+            return Inverse4Sse( a.Data(), r.Data() );
+        }
+    };
+#endif
+
+    // 特異とみなすか．行を各行の絶対値の最大で，続けて列を各列の最大で割って揃えた行列の
+    // |det| が tol 以下なら特異 ( 行と列のスケールによらないので，平行移動の大きい姿勢行列も通る )
+    // 0 の行か列があれば特異
+    template<class T, int N, class MA>
+    bool IsSingular( const MA &a, const T &d, const T &tol ) {
+        T ri[N];
+        T q = std::abs(d);
+        for( int i=0; i<N; ++i ) {
+            T m = T();
+            for( int j=0; j<N; ++j ) m = std::max( m, std::abs(a(i,j)) );
+            ri[i] = m > T() ? T(1) / m : T();
+            q *= ri[i];
+        }
+        for( int j=0; j<N; ++j ) {
+            T m = T();
+            for( int i=0; i<N; ++i ) m = std::max( m, std::abs(a(i,j)) * ri[i] );
+            q = m > T() ? q / m : T();
+        }
+        return !( q > tol );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// det ( N <= 4 )
+template<class T, int N>
+T det( const KMat<T,N,N> &a ) {
+    return Detail::ClosedInv<T,N>::Det(a);
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// inverse ( N <= 4 )．特異かどうかは確かめない
+template<class T, int N>
+KMat<T,N,N> inverse( const KMat<T,N,N> &a ) {
+    KMat<T,N,N> r;
+    Detail::InvKMat<T,N>::f(a, r);
+    return r;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 特異でなければ逆行列を inv に入れて true を返す
+/// 行と列を揃えた A の |det| が tol 以下なら特異とみなし，inv には触らない
+template<class T, int N>
+bool try_inverse( const KMat<T,N,N> &a, KMat<T,N,N> &inv, const T &tol = N * std::numeric_limits<T>::epsilon() ) {
+    KMat<T,N,N> r;
+    const T d = Detail::InvKMat<T,N>::f(a, r);
+    if( Detail::IsSingular<T,N>(a, d, tol) ) return false;
+    inv = r;
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 行列の配列をまとめて逆行列にする
+template<class T, int N>
+void inverse_batch( const KMat<T,N,N> *a, KMat<T,N,N> *r, int count ) {
+    for( int b=0; b<count; ++b ) {
+        Detail::InvKMat<T,N>::f(a[b], r[b]);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// det ( 束 )
+template<class T, int N, int B>
+void det_batch( const KMatBatch<T,N,N,B> &a, T *d ) {
+    for( int b=0; b<B; ++b ) {
+        d[b] = Detail::ClosedInv<T,N>::Det( Detail::ConstBatchLane<T,N,N,B>(a, b) );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// inverse ( 束 )．ループの中に分岐がないので束の方向にベクトル化される
+/// ( SSE / AVX のどちらになるかはコンパイラの設定による )
+/// d を渡すと各行列の行列式を入れる
+template<class T, int N, int B>
+void inverse_batch( const KMatBatch<T,N,N,B> &a, KMatBatch<T,N,N,B> &r, T *d = 0 ) {
+    // 行列式がいらないときは捨て場に書く
+    T sink[B];
+    T *dd = d ? d : sink;
+    for( int b=0; b<B; ++b ) {
+        Detail::BatchLane<T,N,N,B> rl(r, b);
+        dd[b] = Detail::ClosedInv<T,N>::Inverse( Detail::ConstBatchLane<T,N,N,B>(a, b), rl );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// try_inverse ( 束 )．ok[b] に特異でないかを入れる．特異な行列の r は不定
+/// 特異でないものの数を返す
+template<class T, int N, int B>
+int try_inverse_batch( const KMatBatch<T,N,N,B> &a, KMatBatch<T,N,N,B> &r, bool *ok,
+                       const T &tol = N * std::numeric_limits<T>::epsilon() ) {
+    T d[B];
+    inverse_batch(a, r, d);
+    int n = 0;
+    for( int b=0; b<B; ++b ) {
+        ok[b] = !Detail::IsSingular<T,N>( Detail::ConstBatchLane<T,N,N,B>(a, b), d[b], tol );
+        if( ok[b] ) ++n;
+    }
+    return n;
+}
+
+} // namespace kblas
+
+/////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,224 @@
+﻿/////////////////////////////////////////////////////////////////////////////
+/** @file
+    @brief  部分ピボット選択付き LU 分解
+    @author oniprog
+*/
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "KMat.h"
+#include "KMatTri.h"
+
+namespace kblas {
+
+namespace Detail {
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // k 列目を消去する ( 0 .. k 列 )．ピボットが 0 なら false
+    template<class T, int N, int k>
+    struct LUStep {
+        static bool f( KMat<T,N,N> &lu, int *piv, int &sign ) {
+            if( !LUStep<T,N,k-1>::f(lu, piv, sign) ) return false;
+
+            int p = k;
+            T big = std::abs(lu(k,k));
+            for( int i=k+1; i<N; ++i ) {
+                const T v = std::abs(lu(i,k));
+                if( v > big ) { big = v; p = i; }
+            }
+            piv[k] = p;
+            if( p != k ) {
+                for( int j=0; j<N; ++j ) std::swap( lu(k,j), lu(p,j) );
+                sign = -sign;
+            }
+            if( lu(k,k) == T() ) return false;
+
+            const T inv = T(1) / lu(k,k);
+            for( int i=k+1; i<N; ++i ) {
+                const T l = lu(i,k) * inv;
+                lu(i,k) = l;
+                for( int j=k+1; j<N; ++j ) lu(i,j) -= l * lu(k,j);
+            }
+            return true;
+        }
+    };
+
+    template<class T, int N>
+    struct LUStep<T,N,-1> {
+        static bool f( KMat<T,N,N> &lu, int *piv, int &sign ) {
+            return true;
+        }
+    };
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// LU 分解 P A = L U ( 部分ピボット選択 )
+/// L ( 単位下三角 ) と U を一つの行列に詰めて持つ．ピボットが 0 なら IsOk() が false
+template<class T, int N>
+class KLU {
+public:
+    KLU() : m_ok(false), m_sign(1) {}
+
+    explicit KLU( const KMat<T,N,N> &a ) {
+        Compute(a);
+    }
+
+    bool Compute( const KMat<T,N,N> &a ) {
+        m_lu = a;
+        m_sign = 1;
+        m_ok = Detail::LUStep<T,N,N-1>::f(m_lu, m_piv, m_sign);
+        return m_ok;
+    }
+
+    bool IsOk() const {
+        return m_ok;
+    }
+
+    /// L と U を詰めたもの
+    const KMat<T,N,N> & MatLU() const {
+        return m_lu;
+    }
+
+    /// k 段目で k 行と入れ替えた行
+    int Pivot( int k ) const {
+        return m_piv[k];
+    }
+
+    /// A x = b を解く
+    KVec<T,N> Solve( const KVec<T,N> &b ) const {
+        KVec<T,N> x(b);
+        for( int k=0; k<N; ++k ) if( m_piv[k] != k ) std::swap( x(k), x(m_piv[k]) );
+        trsv<KLower,KUnit>(m_lu, x);
+        trsv<KUpper,KNonUnit>(m_lu, x);
+        return x;
+    }
+
+    /// A X = B を解く ( 複数右辺 )
+    template<int K>
+    KMat<T,N,K> Solve( const KMat<T,N,K> &b ) const {
+        KMat<T,N,K> x(b);
+        for( int k=0; k<N; ++k ) {
+            if( m_piv[k] != k ) for( int j=0; j<K; ++j ) std::swap( x(k,j), x(m_piv[k],j) );
+        }
+        trsm<KLower,KUnit>(m_lu, x);
+        trsm<KUpper,KNonUnit>(m_lu, x);
+        return x;
+    }
+
+    /// det(A)
+    T Det() const {
+        T d = T(m_sign);
+        for( int i=0; i<N; ++i ) d *= m_lu(i,i);
+        return d;
+    }
+
+    /// A^{-1}
+    KMat<T,N,N> Inverse() const {
+        KMat<T,N,N> e(T(0));
+        for( int i=0; i<N; ++i ) e(i,i) = T(1);
+        return Solve(e);
+    }
+
+private:
+    KMat<T,N,N> m_lu;
+    int         m_piv[N];
+    bool        m_ok;
+    int         m_sign;
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+/// lu
+template<class T, int N>
+KLU<T,N> lu( const KMat<T,N,N> &a ) {
+    return KLU<T,N>(a);
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// solve_refined の経過
+struct KRefineInfo {
+    int     iterations;     ///< 反復改良の回数
+    bool    fallback;       ///< double で分解し直したか
+    double  correction;     ///< 最後の補正の大きさ ( |dx|_inf / |x|_inf )
+    double  backward;       ///< 最後の後退誤差 ( |r|_inf / (|A|_inf |x|_inf + |b|_inf) )
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 混合精度の A x = b
+/// float で LU 分解し，残差 b - A x を double で求めて反復改良する
+/// double の残差から求めた後退誤差が eps ( の sqrt(N) 倍 ) 以下になれば終わり．
+/// 補正が縮まなくなっても sqrt(eps) より小さければ収束とみなす ( cond(A) eps あたりで止まるため )
+/// float で分解できない，NaN が出た，補正が大きくなった，maxIter 回で収束しないときは
+/// double で分解し直して解く
+template<int N>
+KVec<double,N> solve_refined( const KMat<double,N,N> &a, const KVec<double,N> &b, KRefineInfo *info = 0,
+                              int maxIter = 10 ) {
+    KRefineInfo st;
+    st.iterations = 0;
+    st.fallback = false;
+    st.correction = 0;
+    st.backward = 0;
+
+    KMat<float,N,N> af;
+    for( int i=0; i<N; ++i ) for( int j=0; j<N; ++j ) af(i,j) = float(a(i,j));
+    const KLU<float,N> lf(af);
+
+    KVec<double,N> x(0.0);
+    bool conv = false;
+    if( lf.IsOk() ) {
+        const double eps = std::numeric_limits<double>::epsilon();
+        const double tol = eps * std::sqrt(double(N));
+        double an = 0, bn = 0;
+        for( int i=0; i<N; ++i ) {
+            double s = 0;
+            for( int j=0; j<N; ++j ) s += std::abs(a(i,j));
+            an = std::max( an, s );
+            bn = std::max( bn, std::abs(b(i)) );
+        }
+        KVec<double,N> r(b);
+        double prev = std::numeric_limits<double>::max();
+        while( st.iterations < maxIter ) {
+            KVec<float,N> rf;
+            for( int i=0; i<N; ++i ) rf(i) = float(r(i));
+            const KVec<float,N> d = lf.Solve(rf);
+
+            double dn = 0, xn = 0;
+            for( int i=0; i<N; ++i ) {
+                x(i) += d(i);
+                dn = std::max( dn, std::abs(double(d(i))) );
+                xn = std::max( xn, std::abs(x(i)) );
+            }
+            ++st.iterations;
+            st.correction = xn > 0 ? dn / xn : dn;
+            if( !(dn == dn) || dn > prev ) break;       // NaN か，大きくなった
+
+            const KVec<double,N> ax = prod(a, x);
+            double rn = 0;
+            for( int i=0; i<N; ++i ) {
+                r(i) = b(i) - ax(i);
+                rn = std::max( rn, std::abs(r(i)) );
+            }
+            const double den = an * xn + bn;
+            st.backward = den > 0 ? rn / den : rn;
+            if( st.backward <= tol || (dn > prev / 2 && st.correction <= std::sqrt(eps)) ) {
+                conv = true;
+                break;
+            }
+            prev = dn;
+        }
+    }
+    if( !conv ) {
+        st.fallback = true;
+        x = KLU<double,N>(a).Solve(b);
+    }
+    if( info ) *info = st;
+    return x;
+}
+
+} // namespace kblas
+
+/////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,507 @@
+﻿/////////////////////////////////////////////////////////////////////////////
+/** @file
+    @brief  Householder QR 分解と最小二乗解，列ピボット選択つきの完全直交分解
+    @author oniprog
+*/
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "KMat.h"
+#include "KMatTri.h"
+
+namespace kblas {
+
+namespace Detail {
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // Householder 変換 H_k = I - tau v v^T
+    // v(k) = 1, v(i) = qr(i,k) ( i > k ) として qr の下三角に格納する
+
+    // k 列目の鏡映を作って，k+1 列目以降に掛ける
+    template<class T, int M, int N, int k>
+    struct HouseStep {
+        static void f( KMat<T,M,N> &qr, KVec<T,N> &tau ) {
+            HouseStep<T,M,N,k-1>::f(qr, tau);
+
+            T sigma = T();
+            for( int i=k+1; i<M; ++i ) sigma += qr(i,k) * qr(i,k);
+
+            const T alpha = qr(k,k);
+            if( sigma == T() ) {
+                tau(k) = T();
+                return;
+            }
+            T beta = std::sqrt(alpha * alpha + sigma);
+            if( alpha > T() ) beta = -beta;
+            tau(k) = (beta - alpha) / beta;
+            const T scale = T(1) / (alpha - beta);
+            for( int i=k+1; i<M; ++i ) qr(i,k) *= scale;
+            qr(k,k) = beta;
+
+            for( int j=k+1; j<N; ++j ) {
+                T w = qr(k,j);
+                for( int i=k+1; i<M; ++i ) w += qr(i,k) * qr(i,j);
+                w *= tau(k);
+                qr(k,j) -= w;
+                for( int i=k+1; i<M; ++i ) qr(i,j) -= w * qr(i,k);
+            }
+        }
+    };
+
+    template<class T, int M, int N>
+    struct HouseStep<T,M,N,-1> {
+        static void f( KMat<T,M,N> &qr, KVec<T,N> &tau ) {
+        }
+    };
+
+    // b に H_k を掛ける
+    template<class T, int M, int N, int k>
+    inline void HouseApply( const KMat<T,M,N> &qr, const KVec<T,N> &tau, KVec<T,M> &b ) {
+        T w = b(k);
+        for( int i=k+1; i<M; ++i ) w += qr(i,k) * b(i);
+        w *= tau(k);
+        b(k) -= w;
+        for( int i=k+1; i<M; ++i ) b(i) -= w * qr(i,k);
+    }
+
+    // Q^T b = H_{N-1} ... H_0 b
+    template<class T, int M, int N, int k>
+    struct HouseQt {
+        static void f( const KMat<T,M,N> &qr, const KVec<T,N> &tau, KVec<T,M> &b ) {
+            HouseQt<T,M,N,k-1>::f(qr, tau, b);
+            HouseApply<T,M,N,k>(qr, tau, b);
+        }
+    };
+
+    template<class T, int M, int N>
+    struct HouseQt<T,M,N,-1> {
+        static void f( const KMat<T,M,N> &qr, const KVec<T,N> &tau, KVec<T,M> &b ) {
+        }
+    };
+
+    // Q b = H_0 ... H_{N-1} b
+    template<class T, int M, int N, int k>
+    struct HouseQ {
+        static void f( const KMat<T,M,N> &qr, const KVec<T,N> &tau, KVec<T,M> &b ) {
+            HouseApply<T,M,N,k>(qr, tau, b);
+            HouseQ<T,M,N,k-1>::f(qr, tau, b);
+        }
+    };
+
+    template<class T, int M, int N>
+    struct HouseQ<T,M,N,-1> {
+        static void f( const KMat<T,M,N> &qr, const KVec<T,N> &tau, KVec<T,M> &b ) {
+        }
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // Givens 回転 [c s; -s c] [a; b] = [r; 0]．r を返す
+    template<class T>
+    T Givens( const T &a, const T &b, T &c, T &s ) {
+        if( b == T() ) {
+            c = T(1);
+            s = T();
+            return a;
+        }
+        const T h = std::hypot(a, b);
+        c = a / h;
+        s = b / h;
+        return h;
+    }
+
+    // 2 本の並び x, y に回転をかける ( x <- c x + s y, y <- c y - s x )
+    // 連続したメモリを同じ形でなめるだけなのでベクトル化される
+    template<class T>
+    void RotPair( T *x, T *y, int n, T c, T s ) {
+        for( int j=0; j<n; ++j ) {
+            const T a = x[j], b = y[j];
+            x[j] = c * a + s * b;
+            y[j] = c * b - s * a;
+        }
+    }
+
+#ifdef KBLAS_USE_SSE
+    // float は SSE で 4 つずつ回す
+    inline void RotPair( float *x, float *y, int n, float c, float s ) {
+        const __m128 vc = _mm_set1_ps(c);
+        const __m128 vs = _mm_set1_ps(s);
+        int j = 0;
+        for( ; j+4<=n; j+=4 ) {
+            const __m128 a = _mm_loadu_ps(x + j);
+            const __m128 b = _mm_loadu_ps(y + j);
+            _mm_storeu_ps( x + j, _mm_add_ps( _mm_mul_ps(vc, a), _mm_mul_ps(vs, b) ) );
+            _mm_storeu_ps( y + j, _mm_sub_ps( _mm_mul_ps(vc, b), _mm_mul_ps(vs, a) ) );
+        }
+        for( ; j<n; ++j ) {
+            const float a = x[j], b = y[j];
+            x[j] = c * a + s * b;
+            y[j] = c * b - s * a;
+        }
+    }
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// Householder QR 分解 A = Q R ( M >= N )
+/// Q は鏡映ベクトルのまま持ち，陽には作らない
+template<class T, int M, int N>
+class KQR {
+    static_assert( M >= N, "KQR needs M >= N" );
+public:
+    KQR() : m_ok(false) {}
+
+    explicit KQR( const KMat<T,M,N> &a ) {
+        Compute(a);
+    }
+
+    /// 分解する．R の対角に 0 があれば false ( フルランクでない )
+    bool Compute( const KMat<T,M,N> &a ) {
+        m_qr = a;
+        Detail::HouseStep<T,M,N,N-1>::f(m_qr, m_tau);
+        m_ok = true;
+        for( int i=0; i<N; ++i ) if( m_qr(i,i) == T() ) m_ok = false;
+        return m_ok;
+    }
+
+    bool IsOk() const {
+        return m_ok;
+    }
+
+    /// 上三角因子 R
+    KMat<T,N,N> MatR() const {
+        KMat<T,N,N> r;
+        for( int i=0; i<N; ++i ) for( int j=0; j<N; ++j ) {
+            r(i,j) = j < i ? T() : m_qr(i,j);
+        }
+        return r;
+    }
+
+    /// Q^T b
+    KVec<T,M> ApplyQt( const KVec<T,M> &b ) const {
+        KVec<T,M> r(b);
+        Detail::HouseQt<T,M,N,N-1>::f(m_qr, m_tau, r);
+        return r;
+    }
+
+    /// Q b
+    KVec<T,M> ApplyQ( const KVec<T,M> &b ) const {
+        KVec<T,M> r(b);
+        Detail::HouseQ<T,M,N,N-1>::f(m_qr, m_tau, r);
+        return r;
+    }
+
+    /// 薄い Q ( M x N )
+    KMat<T,M,N> ThinQ() const {
+        KMat<T,M,N> q;
+        for( int j=0; j<N; ++j ) {
+            KVec<T,M> e(T(0));
+            e(j) = T(1);
+            Detail::HouseQ<T,M,N,N-1>::f(m_qr, m_tau, e);
+            for( int i=0; i<M; ++i ) q(i,j) = e(i);
+        }
+        return q;
+    }
+
+    /// min |A x - b| の解
+    KVec<T,N> SolveLeastSquares( const KVec<T,M> &b ) const {
+        const KVec<T,M> c = ApplyQt(b);
+        KVec<T,N> x;
+        for( int i=0; i<N; ++i ) x(i) = c(i);
+        Detail::Tri<KUpper,KNonUnit,T,N>::Vec(x, m_qr);     // R は m_qr の上 N 行
+        return x;
+    }
+
+    /// 内部表現 ( 上三角が R, 下三角が鏡映ベクトル )
+    const KMat<T,M,N> & Packed() const {
+        return m_qr;
+    }
+
+    /// 鏡映の係数
+    const KVec<T,N> & Tau() const {
+        return m_tau;
+    }
+
+private:
+    KMat<T,M,N> m_qr;
+    KVec<T,N>   m_tau;
+    bool        m_ok;
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+/// qr
+template<class T, int M, int N>
+KQR<T,M,N> qr( const KMat<T,M,N> &a ) {
+    return KQR<T,M,N>(a);
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 最小二乗解 min |A x - b|
+template<class T, int M, int N>
+KVec<T,N> solve_least_squares( const KMat<T,M,N> &a, const KVec<T,M> &b ) {
+    return KQR<T,M,N>(a).SolveLeastSquares(b);
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 完全直交分解 A P = Q [ T 0 ; 0 0 ] Z ( 列ピボット選択つき QR でランクを決める )
+/// T は r x r の上三角 ( r は数値ランク )．M, N の大小は問わない
+/// SVD よりずっと安く，ランク落ちした A の最小ノルム解と擬似逆行列が求まる
+template<class T, int M, int N>
+class KCOD {
+public:
+    static const int K = M < N ? M : N;
+
+public:
+    KCOD() : m_rank(0) {}
+
+    explicit KCOD( const KMat<T,M,N> &a, T tol = T(-1) ) {
+        Compute(a, tol);
+    }
+
+    /// 分解する．|R(k,k)| <= tol |R(0,0)| となる k からをランク落ちとみなす
+    /// tol < 0 なら max(M,N) eps を使う．ランクを返す
+    int Compute( const KMat<T,M,N> &a, T tol = T(-1) ) {
+        if( tol < T() ) tol = std::max(M, N) * std::numeric_limits<T>::epsilon();
+        m_qr = a;
+        for( int j=0; j<N; ++j ) m_perm[j] = j;
+
+        // 列ピボット選択つき Householder QR ( 鏡映は下三角に持つ )
+        for( int k=0; k<K; ++k ) {
+            int p = k;
+            T big = T(-1);
+            for( int j=k; j<N; ++j ) {
+                T s = T();
+                for( int i=k; i<M; ++i ) s += m_qr(i,j) * m_qr(i,j);
+                if( s > big ) { big = s; p = j; }
+            }
+            if( p != k ) {
+                for( int i=0; i<M; ++i ) std::swap( m_qr(i,k), m_qr(i,p) );
+                std::swap( m_perm[k], m_perm[p] );
+            }
+
+            T sigma = T();
+            for( int i=k+1; i<M; ++i ) sigma += m_qr(i,k) * m_qr(i,k);
+            const T alpha = m_qr(k,k);
+            if( sigma == T() ) {
+                m_tauQ[k] = T();
+                continue;
+            }
+            T beta = std::sqrt(alpha * alpha + sigma);
+            if( alpha > T() ) beta = -beta;
+            m_tauQ[k] = (beta - alpha) / beta;
+            const T scale = T(1) / (alpha - beta);
+            for( int i=k+1; i<M; ++i ) m_qr(i,k) *= scale;
+            m_qr(k,k) = beta;
+
+            for( int j=k+1; j<N; ++j ) {
+                T w = m_qr(k,j);
+                for( int i=k+1; i<M; ++i ) w += m_qr(i,k) * m_qr(i,j);
+                w *= m_tauQ[k];
+                m_qr(k,j) -= w;
+                for( int i=k+1; i<M; ++i ) m_qr(i,j) -= w * m_qr(i,k);
+            }
+        }
+
+        // 数値ランク
+        const T r0 = std::abs(m_qr(0,0));
+        m_rank = 0;
+        while( m_rank < K && std::abs(m_qr(m_rank,m_rank)) > tol * r0 ) ++m_rank;
+        const int r = m_rank;
+
+        // [R11 R12] を右から鏡映で [T 0] にする ( 鏡映は R12 の場所に持つ )
+        for( int k=r-1; k>=0; --k ) {
+            m_tauZ[k] = T();
+            if( r == N ) continue;
+
+            T sigma = T();
+            for( int j=r; j<N; ++j ) sigma += m_qr(k,j) * m_qr(k,j);
+            if( sigma == T() ) continue;
+            const T alpha = m_qr(k,k);
+            T beta = std::sqrt(alpha * alpha + sigma);
+            if( alpha > T() ) beta = -beta;
+            m_tauZ[k] = (beta - alpha) / beta;
+            const T scale = T(1) / (alpha - beta);
+            for( int j=r; j<N; ++j ) m_qr(k,j) *= scale;
+            m_qr(k,k) = beta;
+
+            for( int i=0; i<k; ++i ) {
+                T w = m_qr(i,k);
+                for( int j=r; j<N; ++j ) w += m_qr(i,j) * m_qr(k,j);
+                w *= m_tauZ[k];
+                m_qr(i,k) -= w;
+                for( int j=r; j<N; ++j ) m_qr(i,j) -= w * m_qr(k,j);
+            }
+        }
+        return m_rank;
+    }
+
+    /// 数値ランク
+    int Rank() const {
+        return m_rank;
+    }
+
+    /// A P の j 列目は A の Perm(j) 列目
+    int Perm( int j ) const {
+        return m_perm[j];
+    }
+
+    /// 最小ノルムの最小二乗解 min |x| s.t. min |A x - b|
+    KVec<T,N> Solve( const KVec<T,M> &b ) const {
+        const int r = m_rank;
+
+        // c = Q^T b ( 先頭 r 個だけ使う )
+        KVec<T,M> c(b);
+        for( int k=0; k<r; ++k ) {
+            T w = c(k);
+            for( int i=k+1; i<M; ++i ) w += m_qr(i,k) * c(i);
+            w *= m_tauQ[k];
+            c(k) -= w;
+            for( int i=k+1; i<M; ++i ) c(i) -= w * m_qr(i,k);
+        }
+
+        // T y = c
+        KVec<T,N> y(T(0));
+        for( int i=r-1; i>=0; --i ) {
+            T s = c(i);
+            for( int j=i+1; j<r; ++j ) s -= m_qr(i,j) * y(j);
+            y(i) = s / m_qr(i,i);
+        }
+
+        // Z^T y
+        for( int k=0; k<r; ++k ) {
+            if( m_tauZ[k] == T() ) continue;
+            T w = y(k);
+            for( int j=r; j<N; ++j ) w += m_qr(k,j) * y(j);
+            w *= m_tauZ[k];
+            y(k) -= w;
+            for( int j=r; j<N; ++j ) y(j) -= w * m_qr(k,j);
+        }
+
+        KVec<T,N> x;
+        for( int j=0; j<N; ++j ) x(m_perm[j]) = y(j);
+        return x;
+    }
+
+    /// 擬似逆行列 A^+ ( N x M )
+    KMat<T,N,M> PseudoInverse() const {
+        KMat<T,N,M> p;
+        for( int j=0; j<M; ++j ) {
+            KVec<T,M> e(T(0));
+            e(j) = T(1);
+            const KVec<T,N> x = Solve(e);
+            for( int i=0; i<N; ++i ) p(i,j) = x(i);
+        }
+        return p;
+    }
+
+private:
+    KMat<T,M,N> m_qr;
+    T           m_tauQ[K];
+    T           m_tauZ[K];
+    int         m_perm[N];
+    int         m_rank;
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 擬似逆行列 ( 完全直交分解による )
+template<class T, int M, int N>
+KMat<T,N,M> pinv( const KMat<T,M,N> &a, T tol = T(-1) ) {
+    return KCOD<T,M,N>(a, tol).PseudoInverse();
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 最小ノルムの最小二乗解 ( ランク落ちしていてもよい )
+template<class T, int M, int N>
+KVec<T,N> solve_min_norm( const KMat<T,M,N> &a, const KVec<T,M> &b, T tol = T(-1) ) {
+    return KCOD<T,M,N>(a, tol).Solve(b);
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// Givens 回転 [c s; -s c] [a; b] = [r; 0] を作り，r を返す
+template<class T>
+T givens( const T &a, const T &b, T &c, T &s ) {
+    return Detail::Givens(a, b, c, s);
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 行 i, k に Givens 回転をかける ( 列 j0 から )
+///   a(i,:) <- c a(i,:) + s a(k,:),  a(k,:) <- c a(k,:) - s a(i,:)
+/// 行は連続しているので列の方向にベクトル化される
+template<class T, int M, int N>
+void rot_rows( KMat<T,M,N> &a, int i, int k, const T &c, const T &s, int j0 = 0 ) {
+    Detail::RotPair( &a(i,j0), &a(k,j0), N - j0, c, s );
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// A の R 因子 ( N x N 上三角 ) を，A に行 x を足したものの R 因子に更新する ( O(N^2) )
+/// x を R の各行と Givens 回転で順に消していく
+/// qtb を渡す版は，最小二乗の右辺 Q^T b ( 上 N 個 ) を b に y を足したものに合わせて更新する
+template<class T, int N>
+void qr_append_row( KMat<T,N,N> &r, const KVec<T,N> &x ) {
+    T w[N];
+    for( int j=0; j<N; ++j ) w[j] = x(j);
+    for( int k=0; k<N; ++k ) {
+        T c, s;
+        r(k,k) = Detail::Givens( r(k,k), w[k], c, s );
+        Detail::RotPair( &r(k,k) + 1, w + k + 1, N - k - 1, c, s );
+    }
+}
+
+template<class T, int N>
+void qr_append_row( KMat<T,N,N> &r, KVec<T,N> &qtb, const KVec<T,N> &x, const T &y ) {
+    T w[N+1];
+    for( int j=0; j<N; ++j ) w[j] = x(j);
+    w[N] = y;
+    for( int k=0; k<N; ++k ) {
+        T c, s;
+        r(k,k) = Detail::Givens( r(k,k), w[k], c, s );
+        Detail::RotPair( &r(k,k) + 1, w + k + 1, N - k - 1, c, s );
+        const T z = qtb(k);
+        qtb(k) = c * z + s * w[N];
+        w[N] = c * w[N] - s * z;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// A の R 因子を，A から行 x を除いたものの R 因子に更新する ( O(N^2)，LINPACK dchdd の方法 )
+/// R^T a = x を解いて alpha = sqrt(1 - |a|^2) を作り，下から Givens 回転で a を alpha に畳み込む
+/// 除くと A がフルランクでなくなる ( |a| >= 1 ) ときは r, qtb に触らずに false を返す
+template<class T, int N>
+bool qr_remove_row( KMat<T,N,N> &r, const KVec<T,N> &x ) {
+    KVec<T,N> qtb(T(0));
+    return qr_remove_row( r, qtb, x, T(0) );
+}
+
+template<class T, int N>
+bool qr_remove_row( KMat<T,N,N> &r, KVec<T,N> &qtb, const KVec<T,N> &x, const T &y ) {
+    for( int i=0; i<N; ++i ) if( r(i,i) == T() ) return false;
+    KVec<T,N> a(x);
+    trsv_trans<KUpper,KNonUnit>( r, a );
+    T n2 = T();
+    for( int i=0; i<N; ++i ) n2 += a(i) * a(i);
+    if( !(n2 < T(1)) ) return false;
+
+    T c[N], s[N];
+    T alpha = std::sqrt( T(1) - n2 );
+    for( int i=N-1; i>=0; --i ) alpha = Detail::Givens( alpha, a(i), c[i], s[i] );
+
+    // 消えていく行 xx を下から順に R の各行と回す
+    T xx[N];
+    for( int j=0; j<N; ++j ) xx[j] = T();
+    for( int i=N-1; i>=0; --i ) Detail::RotPair( xx + i, &r(i,i), N - i, c[i], s[i] );
+
+    T zeta = y;
+    for( int i=0; i<N; ++i ) {
+        qtb(i) = (qtb(i) - s[i] * zeta) / c[i];
+        zeta = c[i] * zeta - s[i] * qtb(i);
+    }
+    return true;
+}
+
+} // namespace kblas
+
+/////////////////////////////////////////////////////////////////////////////
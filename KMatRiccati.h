@@ -0,0 +1,153 @@
+﻿/////////////////////////////////////////////////////////////////////////////
+/** @file
+    @brief  離散時間の代数 Riccati 方程式と LQR ゲイン ( 構造保存倍加法 )
+    @author oniprog
+*/
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "KMat.h"
+#include "KMatChol.h"
+#include "KMatLU.h"
+
+namespace kblas {
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 離散時間の代数 Riccati 方程式
+///   X = A^T X A - A^T X B (R + B^T X B)^{-1} B^T X A + Q
+/// を構造保存倍加法 ( SDA, Chu et al. 2004 ) で解き，LQR ゲイン K = (R + B^T X B)^{-1} B^T X A を求める
+/// 1 回の反復は N x N の LU 1 回と行列積だけで，収束は 2 次
+/// (A,B) が可安定でないか，R が正定値でないときは IsOk() が false になる
+template<class T, int N, int M>
+class KDare {
+public:
+    static const int MAX_ITER = 50;
+
+public:
+    KDare() : m_ok(false), m_iters(0), m_residual(T()) {}
+
+    KDare( const KMat<T,N,N> &a, const KMat<T,N,M> &b, const KMat<T,N,N> &q, const KMat<T,M,M> &r ) {
+        Compute(a, b, q, r);
+    }
+
+    /// tol <= 0 なら N eps を使う
+    bool Compute( const KMat<T,N,N> &a, const KMat<T,N,M> &b, const KMat<T,N,N> &q, const KMat<T,M,M> &r,
+                  int maxIter = MAX_ITER, T tol = T(-1) ) {
+        if( tol <= T() ) tol = N * std::numeric_limits<T>::epsilon();
+        m_ok = false;
+        m_iters = 0;
+        m_residual = std::numeric_limits<T>::max();
+
+        const KCholesky<T,M> cr(r);
+        if( !cr.IsOk() ) return false;
+
+        // A_0 = A, G_0 = B R^{-1} B^T, H_0 = Q
+        KMat<T,N,N> ak(a), hk(q);
+        KMat<T,M,N> bt;
+        for( int i=0; i<M; ++i ) for( int j=0; j<N; ++j ) bt(i,j) = b(j,i);
+        KMat<T,N,N> gk = prod( b, cr.Solve(bt) );
+
+        bool conv = false;
+        while( m_iters < maxIter && !conv ) {
+            ++m_iters;
+
+            // W = I + G H
+            KMat<T,N,N> w = prod(gk, hk);
+            for( int i=0; i<N; ++i ) w(i,i) += T(1);
+            const KLU<T,N> lw(w);
+            if( !lw.IsOk() ) return false;
+            const KMat<T,N,N> wa = lw.Solve(ak);    // W^{-1} A
+            const KMat<T,N,N> wg = lw.Solve(gk);    // W^{-1} G
+
+            // H += A^T H W^{-1} A, G += A W^{-1} G A^T, A = A W^{-1} A
+            const KMat<T,N,N> dh = prod( trans(ak), prod(hk, wa) );
+            const KMat<T,N,N> dg = prod( prod(ak, wg), trans(ak) );
+            ak = prod(ak, wa);
+
+            T dn = T(), hn = T();
+            for( int i=0; i<N; ++i ) for( int j=0; j<N; ++j ) {
+                // 対称性を保つ
+                const T h = (dh(i,j) + dh(j,i)) / 2;
+                hk(i,j) += h;
+                gk(i,j) += (dg(i,j) + dg(j,i)) / 2;
+                dn = std::max( dn, std::abs(h) );
+                hn = std::max( hn, std::abs(hk(i,j)) );
+            }
+            conv = dn <= tol * hn;
+        }
+        if( !conv ) return false;
+        m_x = hk;
+
+        // K = (R + B^T X B)^{-1} B^T X A
+        const KMat<T,N,M> xb = prod(m_x, b);
+        KMat<T,M,M> s = prod( trans(b), xb );
+        for( int i=0; i<M; ++i ) for( int j=0; j<M; ++j ) s(i,j) += r(i,j);
+        const KCholesky<T,M> cs(s);
+        if( !cs.IsOk() ) return false;
+        const KMat<T,M,N> bxa = prod( trans(xb), a );
+        m_k = cs.Solve(bxa);
+
+        // 残差 |A^T X (A - B K) + Q - X|_1 / max(1, |X|_1)
+        KMat<T,N,N> abk(a);
+        const KMat<T,N,N> bk = prod(b, m_k);
+        for( int i=0; i<N; ++i ) for( int j=0; j<N; ++j ) abk(i,j) -= bk(i,j);
+        KMat<T,N,N> res = prod( trans(a), prod(m_x, abk) );
+        for( int i=0; i<N; ++i ) for( int j=0; j<N; ++j ) res(i,j) += q(i,j) - m_x(i,j);
+        m_residual = Detail::Norm1(res) / std::max( T(1), Detail::Norm1(m_x) );
+
+        m_ok = true;
+        return true;
+    }
+
+    bool IsOk() const {
+        return m_ok;
+    }
+
+    /// 安定化解 X
+    const KMat<T,N,N> & MatX() const {
+        return m_x;
+    }
+
+    /// ゲイン K ( u = -K x )
+    const KMat<T,M,N> & MatK() const {
+        return m_k;
+    }
+
+    /// 倍加法の反復回数
+    int Iterations() const {
+        return m_iters;
+    }
+
+    /// 相対残差
+    T Residual() const {
+        return m_residual;
+    }
+
+private:
+    KMat<T,N,N> m_x;
+    KMat<T,M,N> m_k;
+    bool        m_ok;
+    int         m_iters;
+    T           m_residual;
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+/// dare
+/// LQR ゲイン K を返す．解けなければ 0 行列を返し，iterations, residual ( 0 なら入れない ) で様子が分かる
+template<class T, int N, int M>
+KMat<T,M,N> dare( const KMat<T,N,N> &a, const KMat<T,N,M> &b, const KMat<T,N,N> &q, const KMat<T,M,M> &r,
+                  int *iterations = 0, T *residual = 0 ) {
+    const KDare<T,N,M> d(a, b, q, r);
+    if( iterations ) *iterations = d.Iterations();
+    if( residual ) *residual = d.Residual();
+    return d.IsOk() ? d.MatK() : KMat<T,M,N>(T(0));
+}
+
+} // namespace kblas
+
+/////////////////////////////////////////////////////////////////////////////
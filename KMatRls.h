@@ -0,0 +1,220 @@
+﻿/////////////////////////////////////////////////////////////////////////////
+/** @file
+    @brief  忘却係数つきの逐次最小二乗法 ( RLS )
+    @author oniprog
+*/
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cmath>
+
+#include "KMat.h"
+#include "KMatBatch.h"
+
+namespace kblas {
+
+namespace Detail {
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // RLS の 1 ステップ ( 重み c のデータ (x,y) を足す．c < 0 なら取り除く )
+    //   g = P x, d = lambda / c + x^T g, k = g / d
+    //   w += k (y - w^T x), P = (P - k g^T) / lambda
+    // P は対称なので上三角だけ計算して下に写す．a priori の誤差を返す
+    template<class T, int N>
+    T RlsStep( KMat<T,N,N> &p, KVec<T,N> &w, const KVec<T,N> &x, const T &y, const T &lambda, const T &c ) {
+        T g[N];
+        T e = y;
+        for( int i=0; i<N; ++i ) {
+            T s = T();
+            for( int j=0; j<N; ++j ) s += p(i,j) * x(j);
+            g[i] = s;
+            e -= w(i) * x(i);
+        }
+        T d = lambda / c;
+        for( int i=0; i<N; ++i ) d += x(i) * g[i];
+
+        const T id = T(1) / d;
+        const T il = T(1) / lambda;
+        for( int i=0; i<N; ++i ) {
+            const T ki = g[i] * id;
+            w(i) += ki * e;
+            for( int j=i; j<N; ++j ) {
+                const T v = (p(i,j) - ki * g[j]) * il;
+                p(i,j) = v;
+                p(j,i) = v;
+            }
+        }
+        return e;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 逐次最小二乗法 y ~ w^T x
+/// 忘却係数 lambda ( 0 < lambda <= 1 ) で古いデータを指数的に軽くする
+/// W > 0 なら直近 W 個のデータだけを使う ( スライディング窓 )．窓から出たデータは
+/// その時点の重み lambda^W で取り除く
+/// 1 回の更新はゲイン・重み・共分散をまとめた 1 つのループで O(N^2)
+template<class T, int N, int W = 0>
+class KRls {
+public:
+    static const int WINDOW = W;
+
+public:
+    /// P の初期値は delta I ( 大きいほど初期値 w = 0 を信用しない )
+    explicit KRls( const T &lambda = T(1), const T &delta = T(1E4) ) : m_lambda(lambda) {
+        Reset(delta);
+    }
+
+    void Reset( const T &delta = T(1E4) ) {
+        m_p = KMat<T,N,N>(T(0));
+        for( int i=0; i<N; ++i ) m_p(i,i) = delta;
+        m_w = KVec<T,N>(T(0));
+        m_count = 0;
+        m_head = 0;
+        m_oldWeight = T(1);
+        for( int i=0; i<W; ++i ) m_oldWeight *= m_lambda;
+    }
+
+    /// データ (x,y) を足して，更新前の予測誤差 y - w^T x を返す
+    T Update( const KVec<T,N> &x, const T &y ) {
+        const T e = Detail::RlsStep( m_p, m_w, x, y, m_lambda, T(1) );
+        Slide( x, y );
+        return e;
+    }
+
+    /// w^T x
+    T Predict( const KVec<T,N> &x ) const {
+        T s = T();
+        for( int i=0; i<N; ++i ) s += m_w(i) * x(i);
+        return s;
+    }
+
+    /// 推定した係数
+    const KVec<T,N> & Weights() const {
+        return m_w;
+    }
+
+    /// 逆相関行列 P
+    const KMat<T,N,N> & MatP() const {
+        return m_p;
+    }
+
+    T Lambda() const {
+        return m_lambda;
+    }
+
+    /// 窓の中のデータの数
+    int Count() const {
+        return m_count;
+    }
+
+private:
+    // 窓から出たデータを取り除く
+    void Slide( const KVec<T,N> &x, const T &y ) {
+        if( W <= 0 ) return;
+        if( m_count == W ) {
+            Detail::RlsStep( m_p, m_w, m_x[m_head], m_y[m_head], T(1), -m_oldWeight );
+        } else {
+            ++m_count;
+        }
+        m_x[m_head] = x;
+        m_y[m_head] = y;
+        m_head = (m_head + 1) % W;
+    }
+
+private:
+    KMat<T,N,N> m_p;
+    KVec<T,N>   m_w;
+    T           m_lambda;
+    T           m_oldWeight;
+    int         m_count;
+    int         m_head;
+    KVec<T,N>   m_x[W > 0 ? W : 1];
+    T           m_y[W > 0 ? W : 1];
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+/// B 個の独立な RLS をまとめて更新する ( Structure of Arrays )
+/// どの式も束の方向のループが一番内側で分岐がないので，そのままベクトル化される
+/// 忘却係数は全て共通．スライディング窓は持たない
+template<class T, int N, int B>
+class KRlsBatch {
+public:
+    explicit KRlsBatch( const T &lambda = T(1), const T &delta = T(1E4) ) : m_lambda(lambda) {
+        Reset(delta);
+    }
+
+    void Reset( const T &delta = T(1E4) ) {
+        m_p = KMatBatch<T,N,N,B>(T(0));
+        for( int i=0; i<N; ++i ) {
+            T *p = m_p.Lane(i,i);
+            for( int b=0; b<B; ++b ) p[b] = delta;
+        }
+        m_w = KVecBatch<T,N,B>(T(0));
+    }
+
+    /// 各インスタンスに (x,y) を足す．e を渡すと更新前の予測誤差を入れる
+    void Update( const KVecBatch<T,N,B> &x, const T *y, T *e = 0 ) {
+        T g[N][B], err[B], id[B];
+
+        for( int b=0; b<B; ++b ) {
+            err[b] = y[b];
+            id[b] = m_lambda;
+        }
+        for( int i=0; i<N; ++i ) {
+            for( int b=0; b<B; ++b ) g[i][b] = T();
+            for( int j=0; j<N; ++j ) {
+                const T *p = m_p.Lane(i,j);
+                const T *xj = x.Lane(j);
+                for( int b=0; b<B; ++b ) g[i][b] += p[b] * xj[b];
+            }
+            const T *xi = x.Lane(i);
+            const T *wi = m_w.Lane(i);
+            for( int b=0; b<B; ++b ) {
+                err[b] -= wi[b] * xi[b];
+                id[b] += xi[b] * g[i][b];
+            }
+        }
+        for( int b=0; b<B; ++b ) id[b] = T(1) / id[b];
+
+        const T il = T(1) / m_lambda;
+        for( int i=0; i<N; ++i ) {
+            T *wi = m_w.Lane(i);
+            T k[B];
+            for( int b=0; b<B; ++b ) {
+                k[b] = g[i][b] * id[b];
+                wi[b] += k[b] * err[b];
+            }
+            for( int j=i; j<N; ++j ) {
+                T *pij = m_p.Lane(i,j);
+                T *pji = m_p.Lane(j,i);
+                for( int b=0; b<B; ++b ) {
+                    const T v = (pij[b] - k[b] * g[j][b]) * il;
+                    pij[b] = v;
+                    pji[b] = v;
+                }
+            }
+        }
+        if( e ) for( int b=0; b<B; ++b ) e[b] = err[b];
+    }
+
+    /// 係数の束
+    const KVecBatch<T,N,B> & Weights() const {
+        return m_w;
+    }
+
+    /// P の束
+    const KMatBatch<T,N,N,B> & MatP() const {
+        return m_p;
+    }
+
+private:
+    KMatBatch<T,N,N,B>  m_p;
+    KVecBatch<T,N,B>    m_w;
+    T                   m_lambda;
+};
+
+} // namespace kblas
+
+/////////////////////////////////////////////////////////////////////////////
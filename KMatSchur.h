@@ -0,0 +1,416 @@
+﻿/////////////////////////////////////////////////////////////////////////////
+/** @file
+    @brief  実 Schur 分解 ( Hessenberg 化と Francis の二重シフト QR ) と一般の行列の固有値
+    @author oniprog
+*/
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <limits>
+
+#include "KMat.h"
+
+namespace kblas {
+
+namespace Detail {
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 長さ n ( <= 3 ) の Householder 鏡映 P = I - beta v v^T で x を (alpha,0,..) に写す
+    // x が 0 なら beta = 0
+    template<class T>
+    inline T House3( const T *x, int n, T *v ) {
+        T s = T();
+        for( int i=0; i<n; ++i ) s += x[i] * x[i];
+        if( s == T() ) return T();
+        const T alpha = x[0] >= T() ? -std::sqrt(s) : std::sqrt(s);
+        v[0] = x[0] - alpha;
+        T vv = v[0] * v[0];
+        for( int i=1; i<n; ++i ) {
+            v[i] = x[i];
+            vv += v[i] * v[i];
+        }
+        return T(2) / vv;
+    }
+
+    // P を行 r0.. ( n 行 ) に左から，列 c0..c1 の範囲で掛ける
+    template<class T, int N>
+    inline void HouseLeft( KMat<T,N,N> &h, int r0, int n, const T *v, const T &beta, int c0, int c1 ) {
+        for( int j=c0; j<=c1; ++j ) {
+            T s = T();
+            for( int i=0; i<n; ++i ) s += v[i] * h(r0+i,j);
+            s *= beta;
+            for( int i=0; i<n; ++i ) h(r0+i,j) -= s * v[i];
+        }
+    }
+
+    // P を列 c0.. ( n 列 ) に右から，行 r0..r1 の範囲で掛ける
+    template<class T, int N>
+    inline void HouseRight( KMat<T,N,N> &h, int c0, int n, const T *v, const T &beta, int r0, int r1 ) {
+        for( int i=r0; i<=r1; ++i ) {
+            T s = T();
+            for( int j=0; j<n; ++j ) s += h(i,c0+j) * v[j];
+            s *= beta;
+            for( int j=0; j<n; ++j ) h(i,c0+j) -= s * v[j];
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 上 Hessenberg 化 H = Q^T A Q ( q が 0 でなければ Q を掛け込む )
+    template<class T, int N>
+    void Hessenberg( KMat<T,N,N> &h, KMat<T,N,N> *q ) {
+        for( int k=0; k<N-2; ++k ) {
+            const int n = N - k - 1;
+            T x[N], v[N];
+            for( int i=0; i<n; ++i ) x[i] = h(k+1+i,k);
+
+            T s = T();
+            for( int i=1; i<n; ++i ) s += x[i] * x[i];
+            if( s == T() ) continue;
+
+            T xx = s + x[0] * x[0];
+            const T alpha = x[0] >= T() ? -std::sqrt(xx) : std::sqrt(xx);
+            v[0] = x[0] - alpha;
+            for( int i=1; i<n; ++i ) v[i] = x[i];
+            const T beta = T(2) / (v[0] * v[0] + s);
+
+            HouseLeft( h, k+1, n, v, beta, k, N-1 );
+            HouseRight( h, k+1, n, v, beta, 0, N-1 );
+            if( q ) HouseRight( *q, k+1, n, v, beta, 0, N-1 );
+            for( int i=k+2; i<N; ++i ) h(i,k) = T();
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 窓 [l,hi] に Francis の二重シフト QR を 1 回掛ける ( Golub & Van Loan 7.5.2 )
+    // full なら窓の外の行・列も更新する ( Schur 形を作るとき )
+    template<class T, int N>
+    void FrancisStep( KMat<T,N,N> &h, KMat<T,N,N> *q, int l, int hi, const T &s, const T &t, bool full ) {
+        const int cEnd = full ? N-1 : hi;
+        const int rBeg = full ? 0 : l;
+
+        T x[3], v[3];
+        x[0] = h(l,l) * h(l,l) + h(l,l+1) * h(l+1,l) - s * h(l,l) + t;
+        x[1] = h(l+1,l) * (h(l,l) + h(l+1,l+1) - s);
+        x[2] = l+2 <= hi ? h(l+1,l) * h(l+2,l+1) : T();
+
+        for( int k=l; k<=hi-2; ++k ) {
+            const T beta = House3( x, 3, v );
+            if( beta != T() ) {
+                HouseLeft( h, k, 3, v, beta, std::max(l, k-1), cEnd );
+                HouseRight( h, k, 3, v, beta, rBeg, std::min(k+3, hi) );
+                if( q ) HouseRight( *q, k, 3, v, beta, 0, N-1 );
+            }
+            x[0] = h(k+1,k);
+            x[1] = h(k+2,k);
+            if( k < hi-2 ) x[2] = h(k+3,k);
+        }
+
+        const T beta = House3( x, 2, v );
+        if( beta != T() ) {
+            HouseLeft( h, hi-1, 2, v, beta, std::max(l, hi-2), cEnd );
+            HouseRight( h, hi-1, 2, v, beta, rBeg, hi );
+            if( q ) HouseRight( *q, hi-1, 2, v, beta, 0, N-1 );
+        }
+
+        // 追い出したバルジの跡を 0 にする
+        for( int k=l; k<hi-2; ++k ) h(k+2,k) = h(k+3,k) = T();
+        h(hi,hi-2) = T();
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 2x2 の対角ブロック (p,p+1) の固有値が実数なら回転で上三角にする
+    template<class T, int N>
+    void SplitBlock( KMat<T,N,N> &h, KMat<T,N,N> *q, int p, bool full ) {
+        const T a = h(p,p), b = h(p,p+1), c = h(p+1,p), d = h(p+1,p+1);
+        const T e = (a - d) / 2;
+        const T disc = e * e + b * c;
+        if( disc < T() ) return;
+
+        // d に近い側の固有値
+        const T z = e + (e >= T() ? std::sqrt(disc) : -std::sqrt(disc));
+        const T lambda = z != T() ? d - b * c / z : d;
+
+        // 固有ベクトルを第 1 列に持つ回転
+        T x0 = lambda - d, x1 = c;
+        if( std::abs(b) + std::abs(lambda - a) > std::abs(x0) + std::abs(x1) ) {
+            x0 = b;
+            x1 = lambda - a;
+        }
+        const T r = std::sqrt(x0 * x0 + x1 * x1);
+        if( r == T() ) return;
+        const T cs = x0 / r, sn = x1 / r;
+
+        const int cEnd = full ? N-1 : p+1;
+        const int rBeg = full ? 0 : p;
+        for( int j=p; j<=cEnd; ++j ) {
+            const T u = h(p,j), w = h(p+1,j);
+            h(p,j)   =  cs * u + sn * w;
+            h(p+1,j) = -sn * u + cs * w;
+        }
+        for( int i=rBeg; i<=p+1; ++i ) {
+            const T u = h(i,p), w = h(i,p+1);
+            h(i,p)   = cs * u + sn * w;
+            h(i,p+1) = -sn * u + cs * w;
+        }
+        if( q ) {
+            KMat<T,N,N> &qq = *q;
+            for( int i=0; i<N; ++i ) {
+                const T u = qq(i,p), w = qq(i,p+1);
+                qq(i,p)   = cs * u + sn * w;
+                qq(i,p+1) = -sn * u + cs * w;
+            }
+        }
+        h(p+1,p) = T();
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // Hessenberg 行列を準上三角にする．収束しなければ false
+    // full でなければ対角ブロックだけが正しい ( 固有値だけが欲しいとき )
+    template<class T, int N>
+    bool HessenbergQR( KMat<T,N,N> &h, KMat<T,N,N> *q, bool full, int maxIter, int &iters ) {
+        const T eps = std::numeric_limits<T>::epsilon();
+        T norm = T();
+        for( int i=0; i<N; ++i ) for( int j=std::max(i-1, 0); j<N; ++j ) norm += std::abs(h(i,j));
+
+        iters = 0;
+        int its = 0;
+        int hi = N - 1;
+        while( hi >= 1 ) {
+            // 小さな副対角を探す
+            int l = hi;
+            for( ; l>0; --l ) {
+                T s = std::abs(h(l-1,l-1)) + std::abs(h(l,l));
+                if( s == T() ) s = norm;
+                if( std::abs(h(l,l-1)) <= eps * s ) {
+                    h(l,l-1) = T();
+                    break;
+                }
+            }
+
+            if( l == hi ) {
+                hi -= 1;
+                its = 0;
+                continue;
+            }
+            if( l == hi-1 ) {
+                SplitBlock( h, q, hi-1, full );
+                hi -= 2;
+                its = 0;
+                continue;
+            }
+            if( its >= maxIter ) return false;
+            ++its;
+            ++iters;
+
+            T s, t;
+            if( its % 10 == 0 ) {
+                // 例外シフト
+                const T e = std::abs(h(hi,hi-1)) + std::abs(h(hi-1,hi-2));
+                const T h11 = T(0.75) * e + h(hi,hi);
+                s = 2 * h11;
+                t = h11 * h11 + T(0.4375) * e * e;
+            } else {
+                s = h(hi-1,hi-1) + h(hi,hi);
+                t = h(hi-1,hi-1) * h(hi,hi) - h(hi-1,hi) * h(hi,hi-1);
+            }
+            FrancisStep( h, q, l, hi, s, t, full );
+        }
+        return true;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 準上三角 T の対角ブロックから固有値を取り出す
+    template<class T, int N>
+    void QuasiTriEigenvalues( const KMat<T,N,N> &t, KVec<std::complex<T>,N> &w ) {
+        for( int i=0; i<N; ) {
+            if( i+1 < N && t(i+1,i) != T() ) {
+                const T a = t(i,i), b = t(i,i+1), c = t(i+1,i), d = t(i+1,i+1);
+                const T m = (a + d) / 2;
+                const T e = (a - d) / 2;
+                const T disc = e * e + b * c;
+                const T r = std::sqrt(std::abs(disc));
+                if( disc >= T() ) {
+                    w(i)   = std::complex<T>( m + r, T() );
+                    w(i+1) = std::complex<T>( m - r, T() );
+                } else {
+                    w(i)   = std::complex<T>( m, r );
+                    w(i+1) = std::complex<T>( m, -r );
+                }
+                i += 2;
+            } else {
+                w(i) = std::complex<T>( t(i,i), T() );
+                i += 1;
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 実 Schur 分解 A = Q T Q^T
+/// T は準上三角 ( 対角に 1x1 と，複素共役の固有値を持つ 2x2 のブロックが並ぶ )
+/// 実数の固有値を持つ 2x2 ブロックは回転で分けておく
+template<class T, int N>
+class KRealSchur {
+public:
+    /// 1 つの固有値あたりの反復の上限
+    static const int MAX_ITER = 40;
+
+public:
+    KRealSchur() : m_ok(false), m_iters(0) {}
+
+    explicit KRealSchur( const KMat<T,N,N> &a, bool computeQ = true ) {
+        Compute(a, computeQ);
+    }
+
+    bool Compute( const KMat<T,N,N> &a, bool computeQ = true ) {
+        m_t = a;
+        m_q = KMat<T,N,N>(T(0));
+        for( int i=0; i<N; ++i ) m_q(i,i) = T(1);
+
+        KMat<T,N,N> *q = computeQ ? &m_q : 0;
+        Detail::Hessenberg( m_t, q );
+        m_ok = Detail::HessenbergQR( m_t, q, true, MAX_ITER, m_iters );
+        return m_ok;
+    }
+
+    bool IsOk() const {
+        return m_ok;
+    }
+
+    /// 準上三角 T
+    const KMat<T,N,N> & MatT() const {
+        return m_t;
+    }
+
+    /// 直交行列 Q ( computeQ = false なら単位行列 )
+    const KMat<T,N,N> & MatQ() const {
+        return m_q;
+    }
+
+    /// i 行目から 2x2 のブロックが始まるか
+    bool IsBlock( int i ) const {
+        return i+1 < N && m_t(i+1,i) != T();
+    }
+
+    /// QR 反復の総数
+    int Iterations() const {
+        return m_iters;
+    }
+
+    /// 固有値 ( T の対角ブロックの順，共役な組は虚部が正のものが先 )
+    KVec<std::complex<T>,N> Eigenvalues() const {
+        KVec<std::complex<T>,N> w;
+        Detail::QuasiTriEigenvalues( m_t, w );
+        return w;
+    }
+
+private:
+    KMat<T,N,N> m_t;
+    KMat<T,N,N> m_q;
+    bool        m_ok;
+    int         m_iters;
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+/// real_schur
+template<class T, int N>
+KRealSchur<T,N> real_schur( const KMat<T,N,N> &a, bool computeQ = true ) {
+    return KRealSchur<T,N>(a, computeQ);
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 一般 ( 非対称 ) の実行列の固有値
+/// 固有値だけを求める速い経路．Q を作らず，QR 反復は収束していない窓の中だけを更新する
+/// 収束しなかったときは ok ( 0 なら入れない ) が false になり，値は不定
+template<class T, int N>
+KVec<std::complex<T>,N> eigenvalues( const KMat<T,N,N> &a, bool *ok = 0 ) {
+    KMat<T,N,N> h(a);
+    int iters = 0;
+    Detail::Hessenberg( h, (KMat<T,N,N>*)0 );
+    const bool conv = Detail::HessenbergQR( h, (KMat<T,N,N>*)0, false, KRealSchur<T,N>::MAX_ITER, iters );
+    if( ok ) *ok = conv;
+
+    KVec<std::complex<T>,N> w;
+    Detail::QuasiTriEigenvalues( h, w );
+    return w;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// スペクトル半径 max |lambda| をべき乗法で求める
+/// 最も絶対値の大きい固有値が実数 1 つでも，共役な組 ( または +-lambda ) でも収束するよう，
+/// 続く 3 つの反復 x, Ax, A^2x に 2 項の漸化式 A^2x = p Ax + q x を最小二乗で当てはめ，
+/// z^2 - p z - q の根の絶対値を使う
+/// 相対変化が tol 以下になるか maxIter 回で終わる．iterations ( 0 なら入れない ) に回数を入れる
+template<class T, int N>
+T spectral_radius( const KMat<T,N,N> &a, int maxIter = 1000, T tol = T(-1), int *iterations = 0 ) {
+    if( tol < T() ) tol = T(1E3) * std::numeric_limits<T>::epsilon();
+
+    KVec<T,N> u0, u1, u2;
+    T n0 = T();
+    for( int i=0; i<N; ++i ) {
+        u0(i) = T(1) + T(i) / T(2 * N);
+        n0 += u0(i) * u0(i);
+    }
+    n0 = T(1) / std::sqrt(n0);
+    for( int i=0; i<N; ++i ) u0(i) *= n0;
+    u1 = prod(a, u0);
+    u2 = prod(a, u1);
+
+    T rho = T(), prev = T(-1);
+    int it = 0;
+    while( it < maxIter ) {
+        ++it;
+
+        // 正規方程式 [u1.u1 u1.u0; u0.u1 u0.u0] [p; q] = [u1.u2; u0.u2]
+        T s11 = T(), s10 = T(), s00 = T(), r1 = T(), r0 = T();
+        for( int i=0; i<N; ++i ) {
+            s11 += u1(i) * u1(i);
+            s10 += u1(i) * u0(i);
+            s00 += u0(i) * u0(i);
+            r1 += u1(i) * u2(i);
+            r0 += u0(i) * u2(i);
+        }
+        if( s11 == T() ) {          // A^k x = 0 ( べき零 )
+            rho = T();
+            break;
+        }
+
+        // u1 = mu u0 の当てはまりがよければ ( 実数の固有値 1 つ ) mu を使う
+        // このとき 2 項の当てはめは条件が悪く，もう一方の根があてにならない
+        const T mu = s10 / s00;
+        const T det = s11 * s00 - s10 * s10;
+        if( det <= std::sqrt(std::numeric_limits<T>::epsilon()) * s11 * s00 ) {
+            rho = std::abs(mu);
+        } else {
+            const T p = (r1 * s00 - r0 * s10) / det;
+            const T q = (s11 * r0 - s10 * r1) / det;
+            const T disc = p * p + 4 * q;
+            if( disc < T() ) {
+                rho = std::sqrt(-q);
+            } else {
+                const T sd = std::sqrt(disc);
+                rho = std::max( std::abs(p + sd), std::abs(p - sd) ) / 2;
+            }
+        }
+        if( prev >= T() && std::abs(rho - prev) <= tol * rho ) break;
+        prev = rho;
+
+        // 1 つずらして大きさをそろえる
+        const T sc = T(1) / std::sqrt(s11);
+        for( int i=0; i<N; ++i ) {
+            u0(i) = u1(i) * sc;
+            u1(i) = u2(i) * sc;
+        }
+        u2 = prod(a, u1);
+    }
+    if( iterations ) *iterations = it;
+    return rho;
+}
+
+} // namespace kblas
+
+/////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,412 @@
+﻿/////////////////////////////////////////////////////////////////////////////
+/** @file
+    @brief  0 の位置がコンパイル時に決まっている疎行列
+    @author oniprog
+*/
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cassert>
+
+#include "KMat.h"
+#include "KMatBlock.h"
+
+namespace kblas {
+
+template<class T, int M, int N, unsigned long long... R>
+class KSparseFixed;
+
+namespace Detail {
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 立っているビットの数
+    template<unsigned long long X>
+    struct PopCount {
+        static const int value = int(X & 1ULL) + PopCount<(X >> 1)>::value;
+    };
+
+    template<>
+    struct PopCount<0ULL> {
+        static const int value = 0;
+    };
+
+    inline int PopCountRt( unsigned long long x ) {
+        int n = 0;
+        for( ; x; x &= x - 1 ) ++n;
+        return n;
+    }
+
+    // j より下のビット ( j < 64 )
+    template<int j>
+    struct LowBits {
+        static const unsigned long long value = (1ULL << j) - 1ULL;
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 行ごとのマスク R... ( i 行目のビット j が (i,j) ) で表したパターン
+    // i 行目のマスク ( 範囲の外は 0 )
+    template<int i, unsigned long long... R>
+    struct SparseRow {
+        static const unsigned long long value = 0ULL;
+    };
+
+    template<int i, unsigned long long R0, unsigned long long... R>
+    struct SparseRow<i,R0,R...> {
+        static const unsigned long long value = i == 0 ? R0 : SparseRow<i-1,R...>::value;
+    };
+
+    // i 行目より前の 0 でない要素の数 ( i 行目の先頭の詰めた位置 )
+    template<int i, unsigned long long... R>
+    struct SparseRowStart {
+        static const int value = 0;
+    };
+
+    template<int i, unsigned long long R0, unsigned long long... R>
+    struct SparseRowStart<i,R0,R...> {
+        static const int value = i > 0 ? PopCount<R0>::value + SparseRowStart<i-1,R...>::value : 0;
+    };
+
+    template<unsigned long long... R>
+    struct SparsePattern {
+        static const int ROWS = sizeof...(R);
+        static const int NNZ = SparseRowStart<ROWS,R...>::value;
+
+        // (i,j) が 0 でないか
+        template<int i, int j>
+        struct NonZero {
+            static const bool value = ((SparseRow<i,R...>::value >> j) & 1ULL) != 0;
+        };
+
+        // (i,j) の詰めた位置
+        template<int i, int j>
+        struct Index {
+            static const int value = SparseRowStart<i,R...>::value + PopCount<( SparseRow<i,R...>::value & LowBits<j>::value )>::value;
+        };
+
+        static unsigned long long Row( int i ) {
+            static const unsigned long long r[] = { R..., 0ULL };
+            return r[i];
+        }
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 転置したパターンの j 行目 ( 元の j 列目 )．元の行 i から 0 まで
+    template<int j, int i, unsigned long long... R>
+    struct SparseTransRow {
+        static const unsigned long long value =
+            SparseTransRow<j,i-1,R...>::value | ( ((SparseRow<i,R...>::value >> j) & 1ULL) << i );
+    };
+
+    template<int j, unsigned long long... R>
+    struct SparseTransRow<j,-1,R...> {
+        static const unsigned long long value = 0ULL;
+    };
+
+    // 転置した疎行列の型．行 j から N-1 までのマスクを A... に足していく
+    template<class T, int M, int N, int j, class PT, unsigned long long... A>
+    struct SparseTrans;
+
+    template<class T, int M, int N, int j, unsigned long long... R, unsigned long long... A>
+    struct SparseTrans<T,M,N,j,SparsePattern<R...>,A...> {
+        typedef typename SparseTrans<T,M,N,j+1,SparsePattern<R...>,A...,SparseTransRow<j,M-1,R...>::value>::Type Type;
+    };
+
+    template<class T, int M, int N, unsigned long long... R, unsigned long long... A>
+    struct SparseTrans<T,M,N,N,SparsePattern<R...>,A...> {
+        typedef KSparseFixed<T,N,M,A...> Type;
+    };
+}
+
+// 疎行列 ( パターンが固定 )
+// T 型
+// M 行サイズ
+// N 列サイズ ( N <= 64 )
+// R 行ごとのマスク ( M 個 )．i 番目のビット j が立っている (i,j) だけが 0 でない
+// 0 でない要素だけを行優先で詰めて持つ
+template<class T, int M, int N, unsigned long long... R>
+class KSparseFixed {
+    static_assert( int(sizeof...(R)) == M, "KSparseFixed needs one row mask per row" );
+    static_assert( N <= 64, "KSparseFixed needs N <= 64" );
+public:
+    typedef Detail::SparsePattern<R...> Pattern;
+    typedef typename Detail::SparseTrans<T,M,N,0,Pattern>::Type TransType;
+    static const int SIZE_X = N;
+    static const int SIZE_Y = M;
+    static const int NNZ = Pattern::NNZ;
+public:
+
+    KSparseFixed() {}
+
+    /// 0 でない要素をすべて v にする
+    KSparseFixed( const T &v ) {
+        for( int k=0; k<NNZ; ++k ) m_v[k] = v;
+    }
+
+    /// KMat のパターンの位置だけを取り出す ( 他は見ない )
+    explicit KSparseFixed( const KMat<T,M,N> &m ) {
+        int n = 0;
+        for( int i=0; i<M; ++i ) for( int j=0; j<N; ++j ) {
+            if( IsNonZero(i,j) ) m_v[n++] = m(i,j);
+        }
+    }
+
+    /// パターンの外は 0
+    const T operator()(int i, int j) const {
+        return IsNonZero(i,j) ? m_v[Index(i,j)] : T();
+    }
+
+    /// 書き込み用．(i,j) はパターンの中であること
+    T & Ref( int i, int j ) {
+        assert( IsNonZero(i,j) );
+        return m_v[Index(i,j)];
+    }
+
+    /// コンパイル時に位置を決めて読み書きする
+    template<int i, int j>
+    T & At() {
+        static_assert( i >= 0 && i < M && j >= 0 && j < N, "At: out of range" );
+        static_assert( Pattern::template NonZero<i,j>::value, "At: structurally zero" );
+        return m_v[Pattern::template Index<i,j>::value];
+    }
+    template<int i, int j>
+    const T At() const {
+        static_assert( i >= 0 && i < M && j >= 0 && j < N, "At: out of range" );
+        static_assert( Pattern::template NonZero<i,j>::value, "At: structurally zero" );
+        return m_v[Pattern::template Index<i,j>::value];
+    }
+
+    /// 詰めた並び ( NNZ 個 )
+    T * Data() {
+        return m_v;
+    }
+    const T * Data() const {
+        return m_v;
+    }
+
+    /// 密な行列にする
+    KMat<T,M,N> Dense() const {
+        KMat<T,M,N> m;
+        for( int i=0; i<M; ++i ) for( int j=0; j<N; ++j ) m(i,j) = (*this)(i,j);
+        return m;
+    }
+
+    /// 転置 ( パターンも転置する )
+    TransType Trans() const {
+        TransType r;
+        for( int i=0; i<M; ++i ) for( int j=0; j<N; ++j ) {
+            if( IsNonZero(i,j) ) r.Ref(j,i) = m_v[Index(i,j)];
+        }
+        return r;
+    }
+
+    static bool IsNonZero( int i, int j ) {
+        return ((Pattern::Row(i) >> j) & 1ULL) != 0;
+    }
+
+    /// (i,j) の詰めた位置
+    static int Index( int i, int j ) {
+        int k = 0;
+        for( int r=0; r<i; ++r ) k += Detail::PopCountRt( Pattern::Row(r) );
+        return k + Detail::PopCountRt( Pattern::Row(i) & ((1ULL << j) - 1ULL) );
+    }
+
+private:
+    T   m_v[NNZ > 0 ? NNZ : 1];
+};
+
+namespace Detail {
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 1 項を足す．パターンで 0 の項は何も展開しない
+    template<bool NZ>
+    struct SparseTerm {
+        template<int IDX, class T>
+        static T f( const T &acc, const T *a, const T &b ) {
+            return acc + a[IDX] * b;
+        }
+    };
+
+    template<>
+    struct SparseTerm<false> {
+        template<int IDX, class T>
+        static T f( const T &acc, const T *a, const T &b ) {
+            return acc;
+        }
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // S B ( S は M x N の疎，B は N x O．PT は S のパターン )
+    // r(i,j) の k 項まで
+    template<class T, class PT, int i, int j, int k>
+    struct SparseLeft3 {
+        template<class MB>
+        static T f( const T *a, const MB &b ) {
+            return SparseTerm<PT::template NonZero<i,k>::value>::template f<PT::template Index<i,k>::value>(
+                SparseLeft3<T,PT,i,j,k-1>::f(a, b), a, T(b(k,j)) );
+        }
+    };
+
+    template<class T, class PT, int i, int j>
+    struct SparseLeft3<T,PT,i,j,-1> {
+        template<class MB>
+        static T f( const T *a, const MB &b ) {
+            return T();
+        }
+    };
+
+    template<class T, int N, class PT, int i, int j>
+    struct SparseLeft2 {
+        template<class MR, class MB>
+        static void f( MR &r, const T *a, const MB &b ) {
+            r(i,j) = SparseLeft3<T,PT,i,j,N-1>::f(a, b);
+            SparseLeft2<T,N,PT,i,j-1>::f(r, a, b);
+        }
+    };
+
+    template<class T, int N, class PT, int i>
+    struct SparseLeft2<T,N,PT,i,-1> {
+        template<class MR, class MB>
+        static void f( MR &r, const T *a, const MB &b ) {
+        }
+    };
+
+    template<class T, int N, int O, class PT, int i>
+    struct SparseLeft {
+        template<class MR, class MB>
+        static void f( MR &r, const T *a, const MB &b ) {
+            SparseLeft2<T,N,PT,i,O-1>::f(r, a, b);
+            SparseLeft<T,N,O,PT,i-1>::f(r, a, b);
+        }
+    };
+
+    template<class T, int N, int O, class PT>
+    struct SparseLeft<T,N,O,PT,-1> {
+        template<class MR, class MB>
+        static void f( MR &r, const T *a, const MB &b ) {
+        }
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // B S ( B は O x M，S は M x N の疎 )
+    // r(i,j) の k 項まで
+    template<class T, class PT, int i, int j, int k>
+    struct SparseRight3 {
+        template<class MB>
+        static T f( const MB &b, const T *a ) {
+            return SparseTerm<PT::template NonZero<k,j>::value>::template f<PT::template Index<k,j>::value>(
+                SparseRight3<T,PT,i,j,k-1>::f(b, a), a, T(b(i,k)) );
+        }
+    };
+
+    template<class T, class PT, int i, int j>
+    struct SparseRight3<T,PT,i,j,-1> {
+        template<class MB>
+        static T f( const MB &b, const T *a ) {
+            return T();
+        }
+    };
+
+    template<class T, int M, class PT, int i, int j>
+    struct SparseRight2 {
+        template<class MR, class MB>
+        static void f( MR &r, const MB &b, const T *a ) {
+            r(i,j) = SparseRight3<T,PT,i,j,M-1>::f(b, a);
+            SparseRight2<T,M,PT,i,j-1>::f(r, b, a);
+        }
+    };
+
+    template<class T, int M, class PT, int i>
+    struct SparseRight2<T,M,PT,i,-1> {
+        template<class MR, class MB>
+        static void f( MR &r, const MB &b, const T *a ) {
+        }
+    };
+
+    template<class T, int M, int N, class PT, int i>
+    struct SparseRight {
+        template<class MR, class MB>
+        static void f( MR &r, const MB &b, const T *a ) {
+            SparseRight2<T,M,PT,i,N-1>::f(r, b, a);
+            SparseRight<T,M,N,PT,i-1>::f(r, b, a);
+        }
+    };
+
+    template<class T, int M, int N, class PT>
+    struct SparseRight<T,M,N,PT,-1> {
+        template<class MR, class MB>
+        static void f( MR &r, const MB &b, const T *a ) {
+        }
+    };
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// S v
+template<class T, int M, int N, unsigned long long... R>
+KVec<T,M> prod( const KSparseFixed<T,M,N,R...> &a, const KVec<T,N> &v ) {
+    KVec<T,M> r;
+    Detail::ColOf< T,KVec<T,M> > rc(r);
+    Detail::SparseLeft<T,N,1,Detail::SparsePattern<R...>,M-1>::f(rc, a.Data(), Detail::ConstColOf< T,KVec<T,N> >(v));
+    return r;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// S B
+template<class T, int M, int N, int O, unsigned long long... R>
+KMat<T,M,O> prod( const KSparseFixed<T,M,N,R...> &a, const KMat<T,N,O> &b ) {
+    KMat<T,M,O> r;
+    Detail::SparseLeft<T,N,O,Detail::SparsePattern<R...>,M-1>::f(r, a.Data(), b);
+    return r;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// S Bt
+template<class T, int M, int N, int O, unsigned long long... R>
+KMat<T,M,O> prod( const KSparseFixed<T,M,N,R...> &a, const KMatTrans<T,N,O> &b ) {
+    KMat<T,M,O> r;
+    Detail::SparseLeft<T,N,O,Detail::SparsePattern<R...>,M-1>::f(r, a.Data(), b);
+    return r;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// B S
+template<class T, int O, int M, int N, unsigned long long... R>
+KMat<T,O,N> prod( const KMat<T,O,M> &b, const KSparseFixed<T,M,N,R...> &a ) {
+    KMat<T,O,N> r;
+    Detail::SparseRight<T,M,N,Detail::SparsePattern<R...>,O-1>::f(r, b, a.Data());
+    return r;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Bt S
+template<class T, int O, int M, int N, unsigned long long... R>
+KMat<T,O,N> prod( const KMatTrans<T,O,M> &b, const KSparseFixed<T,M,N,R...> &a ) {
+    KMat<T,O,N> r;
+    Detail::SparseRight<T,M,N,Detail::SparsePattern<R...>,O-1>::f(r, b, a.Data());
+    return r;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// v^T S
+template<class T, int M, int N, unsigned long long... R>
+KVec<T,N> prod( const KVec<T,M> &v, const KSparseFixed<T,M,N,R...> &a ) {
+    KVec<T,N> r;
+    Detail::RowOf< T,KVec<T,N> > rr(r);
+    Detail::SparseRight<T,M,N,Detail::SparsePattern<R...>,0>::f(rr, Detail::ConstRowOf< T,KVec<T,M> >(v), a.Data());
+    return r;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// 密な行列に足す ( パターンの位置だけ )
+template<class T, int M, int N, unsigned long long... R>
+KMat<T,M,N> & operator+=( KMat<T,M,N> &m, const KSparseFixed<T,M,N,R...> &a ) {
+    const T *p = a.Data();
+    for( int i=0; i<M; ++i ) for( int j=0; j<N; ++j ) {
+        if( a.IsNonZero(i,j) ) m(i,j) += *p++;
+    }
+    return m;
+}
+
+} // namespace kblas
+
+/////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,473 @@
+﻿/////////////////////////////////////////////////////////////////////////////
+/** @file
+    @brief  特異値分解 ( 3x3 の分岐なし版と，一般の小さな行列の片側 Jacobi 版 )
+    @author oniprog
+*/
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "KMat.h"
+#include "KMatBatch.h"
+
+namespace kblas {
+
+namespace Detail {
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 3x3 の分岐なし SVD ( McAdams et al. 2011 )
+    // A^T A を近似 Givens 回転の Jacobi 法で対角化し ( 回転は四元数で貯める )，
+    // B = A V の列を並べ替えてから Givens 回転の QR で U と特異値を求める
+    // 条件分岐は全て選択 ( ?: ) なので，束の方向に回すとそのままベクトル化される
+
+    template<class T>
+    inline void CondSwap( bool c, T &x, T &y ) {
+        const T z = x;
+        x = c ? y : x;
+        y = c ? z : y;
+    }
+
+    // 交換するときに片方の符号を反転する ( 行列式の符号を保つ )
+    template<class T>
+    inline void CondNegSwap( bool c, T &x, T &y ) {
+        const T z = -x;
+        x = c ? y : x;
+        y = c ? z : y;
+    }
+
+    // 対称行列 S の (1,2) を消す近似 Givens 回転を掛け，四元数 (qa,qb,qc,qw) に貯める
+    // 次に (2,3), (1,3) を同じ式で消せるように S の並びを巡回させる
+    template<class T>
+    inline void Svd3Conjugate( T &s11, T &s21, T &s22, T &s31, T &s32, T &s33, T &qa, T &qb, T &qc, T &qw ) {
+        T ch = 2 * (s11 - s22);
+        T sh = s21;
+        const bool g = T(5.828427124746190) * sh * sh < ch * ch;   // 3 + 2 sqrt(2)
+        const T w = T(1) / std::sqrt(ch * ch + sh * sh);
+        ch = g ? w * ch : T(0.923879532511287);     // cos(pi/8)
+        sh = g ? w * sh : T(0.382683432365090);     // sin(pi/8)
+
+        const T scale = ch * ch + sh * sh;
+        const T a = (ch * ch - sh * sh) / scale;
+        const T b = (2 * sh * ch) / scale;
+
+        const T t11 = s11, t21 = s21, t22 = s22, t31 = s31, t32 = s32, t33 = s33;
+        s11 =  a * ( a * t11 + b * t21) + b * ( a * t21 + b * t22);
+        s21 =  a * (-b * t11 + a * t21) + b * (-b * t21 + a * t22);
+        s22 = -b * (-b * t11 + a * t21) + a * (-b * t21 + a * t22);
+        s31 =  a * t31 + b * t32;
+        s32 = -b * t31 + a * t32;
+        s33 =  t33;
+
+        const T ta = qa * sh, tb = qb * sh, tc = qc * sh;
+        sh *= qw;
+        qa *= ch; qb *= ch; qc *= ch; qw *= ch;
+        qc += sh;
+        qw -= tc;
+        qa += tb;
+        qb -= ta;
+
+        // 巡回
+        const T u11 = s22, u21 = s32, u22 = s33, u31 = s21, u32 = s31, u33 = s11;
+        s11 = u11; s21 = u21; s22 = u22; s31 = u31; s32 = u32; s33 = u33;
+    }
+
+    // QR 用の Givens 回転 ( a1 を残して a2 を消す )．返すのは a = cos, b = sin
+    template<class T>
+    inline void Svd3QRGivens( const T &a1, const T &a2, T &a, T &b ) {
+        const T eps = T(1E-6);
+        const T rho = std::sqrt(a1 * a1 + a2 * a2);
+        T sh = rho > eps ? a2 : T();
+        T ch = std::abs(a1) + (rho > eps ? rho : eps);
+        CondSwap( a1 < T(), sh, ch );
+        const T w = T(1) / std::sqrt(ch * ch + sh * sh);
+        ch *= w;
+        sh *= w;
+        a = 1 - 2 * sh * sh;
+        b = 2 * ch * sh;
+    }
+
+    // S = A^T A の下三角．MA は (i,j) で要素を返すもの
+    template<class T, class MA>
+    inline void Svd3AtA( const MA &a, T &s11, T &s21, T &s22, T &s31, T &s32, T &s33 ) {
+        s11 = a(0,0) * a(0,0) + a(1,0) * a(1,0) + a(2,0) * a(2,0);
+        s21 = a(0,1) * a(0,0) + a(1,1) * a(1,0) + a(2,1) * a(2,0);
+        s22 = a(0,1) * a(0,1) + a(1,1) * a(1,1) + a(2,1) * a(2,1);
+        s31 = a(0,2) * a(0,0) + a(1,2) * a(1,0) + a(2,2) * a(2,0);
+        s32 = a(0,2) * a(0,1) + a(1,2) * a(1,1) + a(2,2) * a(2,1);
+        s33 = a(0,2) * a(0,2) + a(1,2) * a(1,2) + a(2,2) * a(2,2);
+    }
+
+    // V ( 四元数 ) が決まった後の残りは段階に分ける
+    // MA, MB, MU, MV は (i,j)，VS は (i) で要素を返すもの ( KMat, KVec, BatchLane )
+    // 束では段階ごとに束の方向のループにして，それぞれをベクトル化させる
+
+    // 四元数 -> V
+    template<class T, class MV>
+    inline void Svd3QuatToV( T qa, T qb, T qc, T qw, MV &v ) {
+        const T n = T(1) / std::sqrt(qa * qa + qb * qb + qc * qc + qw * qw);
+        qa *= n; qb *= n; qc *= n; qw *= n;
+        v(0,0) = 1 - 2 * (qb * qb + qc * qc);  v(0,1) = 2 * (qa * qb - qw * qc);      v(0,2) = 2 * (qa * qc + qw * qb);
+        v(1,0) = 2 * (qa * qb + qw * qc);      v(1,1) = 1 - 2 * (qa * qa + qc * qc);  v(1,2) = 2 * (qb * qc - qw * qa);
+        v(2,0) = 2 * (qa * qc - qw * qb);      v(2,1) = 2 * (qb * qc + qw * qa);      v(2,2) = 1 - 2 * (qa * qa + qb * qb);
+    }
+
+    // B = A V
+    template<class MA, class MV, class MB>
+    inline void Svd3AV( const MA &a, const MV &v, MB &b ) {
+        for( int i=0; i<3; ++i ) for( int j=0; j<3; ++j ) {
+            b(i,j) = a(i,0) * v(0,j) + a(i,1) * v(1,j) + a(i,2) * v(2,j);
+        }
+    }
+
+    // B の列のノルムの降順に B と V の列を並べ替える
+    template<class T, class MB, class MV>
+    inline void Svd3SortCols( MB &b, MV &v ) {
+        T rho1 = b(0,0) * b(0,0) + b(1,0) * b(1,0) + b(2,0) * b(2,0);
+        T rho2 = b(0,1) * b(0,1) + b(1,1) * b(1,1) + b(2,1) * b(2,1);
+        T rho3 = b(0,2) * b(0,2) + b(1,2) * b(1,2) + b(2,2) * b(2,2);
+        bool c = rho1 < rho2;
+        for( int i=0; i<3; ++i ) { CondNegSwap( c, b(i,0), b(i,1) ); CondNegSwap( c, v(i,0), v(i,1) ); }
+        CondSwap( c, rho1, rho2 );
+        c = rho1 < rho3;
+        for( int i=0; i<3; ++i ) { CondNegSwap( c, b(i,0), b(i,2) ); CondNegSwap( c, v(i,0), v(i,2) ); }
+        CondSwap( c, rho1, rho3 );
+        c = rho2 < rho3;
+        for( int i=0; i<3; ++i ) { CondNegSwap( c, b(i,1), b(i,2) ); CondNegSwap( c, v(i,1), v(i,2) ); }
+    }
+
+    // 並べ替えた B の QR ( Givens 3 回 ) から U と特異値を作る
+    template<class T, class MB, class MU, class VS>
+    inline void Svd3QR( const MB &b, MU &u, VS &s ) {
+        T r[9];
+        for( int i=0; i<3; ++i ) for( int j=0; j<3; ++j ) r[i*3+j] = b(i,j);
+
+        T a1, b1, a2, b2, a3, b3;
+        Svd3QRGivens( r[0], r[3], a1, b1 );
+        for( int j=0; j<3; ++j ) {
+            const T x = r[j], y = r[3+j];
+            r[j] = a1 * x + b1 * y;
+            r[3+j] = -b1 * x + a1 * y;
+        }
+        Svd3QRGivens( r[0], r[6], a2, b2 );
+        for( int j=0; j<3; ++j ) {
+            const T x = r[j], y = r[6+j];
+            r[j] = a2 * x + b2 * y;
+            r[6+j] = -b2 * x + a2 * y;
+        }
+        Svd3QRGivens( r[4], r[7], a3, b3 );
+        for( int j=0; j<3; ++j ) {
+            const T x = r[3+j], y = r[6+j];
+            r[3+j] = a3 * x + b3 * y;
+            r[6+j] = -b3 * x + a3 * y;
+        }
+        s(0) = r[0]; s(1) = r[4]; s(2) = r[8];
+
+        // U = Q1 Q2 Q3
+        const T m00 = a1 * a2, m01 = -b1, m02 = -a1 * b2;
+        const T m10 = b1 * a2, m11 =  a1, m12 = -b1 * b2;
+        const T m20 = b2,      m21 = T(), m22 = a2;
+        u(0,0) = m00;  u(0,1) = a3 * m01 + b3 * m02;  u(0,2) = -b3 * m01 + a3 * m02;
+        u(1,0) = m10;  u(1,1) = a3 * m11 + b3 * m12;  u(1,2) = -b3 * m11 + a3 * m12;
+        u(2,0) = m20;  u(2,1) = a3 * m21 + b3 * m22;  u(2,2) = -b3 * m21 + a3 * m22;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 3x3 の分岐なし SVD  A = U diag(s) V^T
+/// U, V は回転 ( det = +1 )．s は |s| の降順で，det(A) < 0 のときは s(2) が負になる
+/// sweeps は A^T A に掛ける Jacobi の巡回数 ( 固定．float では 5 回で収束する )．u, v は a と別のものを渡すこと
+template<class T>
+void svd3( const KMat<T,3,3> &a, KMat<T,3,3> &u, KVec<T,3> &s, KMat<T,3,3> &v, int sweeps = 5 ) {
+    T s11, s21, s22, s31, s32, s33;
+    Detail::Svd3AtA( a, s11, s21, s22, s31, s32, s33 );
+
+    T q0 = T(), q1 = T(), q2 = T(), qw = T(1);
+    for( int i=0; i<sweeps; ++i ) {
+        Detail::Svd3Conjugate( s11, s21, s22, s31, s32, s33, q0, q1, q2, qw );
+        Detail::Svd3Conjugate( s11, s21, s22, s31, s32, s33, q1, q2, q0, qw );
+        Detail::Svd3Conjugate( s11, s21, s22, s31, s32, s33, q2, q0, q1, qw );
+    }
+
+    KMat<T,3,3> b;
+    Detail::Svd3QuatToV( q0, q1, q2, qw, v );
+    Detail::Svd3AV( a, v, b );
+    Detail::Svd3SortCols<T>( b, v );
+    Detail::Svd3QR<T>( b, u, s );
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 3x3 の SVD ( 束 )．A^T A，Jacobi，V の組み立て，A V，列の並べ替え，QR の各段階を束の方向のループにしているので，
+/// B 個を SIMD でまとめて計算する
+/// ( 選択を if 変換させるため /fp:fast や -fno-trapping-math -fno-math-errno でコンパイルすること )
+template<class T, int B>
+void svd3_batch( const KMatBatch<T,3,3,B> &a, KMatBatch<T,3,3,B> &u, KVecBatch<T,3,B> &s, KMatBatch<T,3,3,B> &v, int sweeps = 5 ) {
+    T s11[B], s21[B], s22[B], s31[B], s32[B], s33[B];
+    T q0[B], q1[B], q2[B], qw[B];
+
+    for( int b=0; b<B; ++b ) {
+        Detail::Svd3AtA( Detail::ConstBatchLane<T,3,3,B>(a, b), s11[b], s21[b], s22[b], s31[b], s32[b], s33[b] );
+        q0[b] = q1[b] = q2[b] = T();
+        qw[b] = T(1);
+    }
+
+    for( int i=0; i<sweeps; ++i ) {
+        for( int b=0; b<B; ++b ) {
+            Detail::Svd3Conjugate( s11[b], s21[b], s22[b], s31[b], s32[b], s33[b], q0[b], q1[b], q2[b], qw[b] );
+            Detail::Svd3Conjugate( s11[b], s21[b], s22[b], s31[b], s32[b], s33[b], q1[b], q2[b], q0[b], qw[b] );
+            Detail::Svd3Conjugate( s11[b], s21[b], s22[b], s31[b], s32[b], s33[b], q2[b], q0[b], q1[b], qw[b] );
+        }
+    }
+
+    for( int b=0; b<B; ++b ) {
+        Detail::BatchLane<T,3,3,B> vl(v, b);
+        Detail::Svd3QuatToV( q0[b], q1[b], q2[b], qw[b], vl );
+    }
+
+    KMatBatch<T,3,3,B> m;
+    for( int b=0; b<B; ++b ) {
+        Detail::BatchLane<T,3,3,B> ml(m, b);
+        Detail::Svd3AV( Detail::ConstBatchLane<T,3,3,B>(a, b), Detail::ConstBatchLane<T,3,3,B>(v, b), ml );
+    }
+
+    for( int b=0; b<B; ++b ) {
+        Detail::BatchLane<T,3,3,B> ml(m, b), vl(v, b);
+        Detail::Svd3SortCols<T>( ml, vl );
+    }
+
+    for( int b=0; b<B; ++b ) {
+        Detail::BatchLane<T,3,3,B> ul(u, b);
+        Detail::VecBatchLane<T,3,B> sl(s, b);
+        Detail::Svd3QR<T>( Detail::ConstBatchLane<T,3,3,B>(m, b), ul, sl );
+    }
+}
+
+namespace Detail {
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 片側 Jacobi 法 ( Hestenes )．w の列同士を回転で直交化する ( R >= C )
+    // v を渡すと回転を貯める．回した巡回数を返す
+    template<class T, int R, int C>
+    int OneSidedJacobi( KMat<T,R,C> &w, KMat<T,C,C> *v, int maxSweeps ) {
+        const T eps = std::numeric_limits<T>::epsilon();
+        int sweep = 0;
+        while( sweep < maxSweeps ) {
+            ++sweep;
+            bool rotated = false;
+            for( int p=0; p<C-1; ++p ) for( int q=p+1; q<C; ++q ) {
+                T alpha = T(), beta = T(), gamma = T();
+                for( int i=0; i<R; ++i ) {
+                    alpha += w(i,p) * w(i,p);
+                    beta  += w(i,q) * w(i,q);
+                    gamma += w(i,p) * w(i,q);
+                }
+                if( !(std::abs(gamma) > eps * std::sqrt(alpha * beta)) ) continue;
+                rotated = true;
+
+                const T zeta = (beta - alpha) / (2 * gamma);
+                const T t = (zeta >= T() ? T(1) : T(-1)) / (std::abs(zeta) + std::sqrt(T(1) + zeta * zeta));
+                const T c = T(1) / std::sqrt(T(1) + t * t);
+                const T s = c * t;
+                for( int i=0; i<R; ++i ) {
+                    const T x = w(i,p), y = w(i,q);
+                    w(i,p) = c * x - s * y;
+                    w(i,q) = s * x + c * y;
+                }
+                if( v ) {
+                    KMat<T,C,C> &vv = *v;
+                    for( int i=0; i<C; ++i ) {
+                        const T x = vv(i,p), y = vv(i,q);
+                        vv(i,p) = c * x - s * y;
+                        vv(i,q) = s * x + c * y;
+                    }
+                }
+            }
+            if( !rotated ) break;
+        }
+        return sweep;
+    }
+
+    // 直交化された w の列のノルムを s に，正規化した列を q に入れる
+    // ノルムが 0 の列は，他の列と直交する単位ベクトルで埋める
+    template<class T, int R, int C>
+    void NormalizeColumns( const KMat<T,R,C> &w, KVec<T,C> &s, KMat<T,R,C> *q ) {
+        for( int j=0; j<C; ++j ) {
+            T sum = T();
+            for( int i=0; i<R; ++i ) sum += w(i,j) * w(i,j);
+            s(j) = std::sqrt(sum);
+            if( q ) {
+                const T inv = s(j) > T() ? T(1) / s(j) : T();
+                for( int i=0; i<R; ++i ) (*q)(i,j) = w(i,j) * inv;
+            }
+        }
+        if( !q ) return;
+
+        for( int j=0; j<C; ++j ) {
+            if( s(j) > T() ) continue;
+            // 残差が一番大きくなる単位ベクトルを他の列に対して直交化する
+            KVec<T,R> best(T(0));
+            T bestNorm = T(-1);
+            for( int k=0; k<R; ++k ) {
+                KVec<T,R> e(T(0));
+                e(k) = T(1);
+                for( int l=0; l<C; ++l ) {
+                    if( l == j || (s(l) == T() && l > j) ) continue;
+                    T d = T();
+                    for( int i=0; i<R; ++i ) d += (*q)(i,l) * e(i);
+                    for( int i=0; i<R; ++i ) e(i) -= d * (*q)(i,l);
+                }
+                T n = T();
+                for( int i=0; i<R; ++i ) n += e(i) * e(i);
+                if( n > bestNorm ) { bestNorm = n; best = e; }
+            }
+            const T inv = T(1) / std::sqrt(bestNorm);
+            for( int i=0; i<R; ++i ) (*q)(i,j) = best(i) * inv;
+        }
+    }
+
+    // 縦長 ( M >= N ) と横長で分ける
+    template<class T, int M, int N, int K, bool TALL>
+    struct SvdCore;
+
+    template<class T, int M, int N, int K>
+    struct SvdCore<T,M,N,K,true> {
+        static int f( const KMat<T,M,N> &a, KMat<T,M,K> *u, KVec<T,K> &s, KMat<T,N,K> *v, int maxSweeps ) {
+            KMat<T,M,N> w(a);
+            if( v ) {
+                for( int i=0; i<N; ++i ) for( int j=0; j<N; ++j ) (*v)(i,j) = (i == j) ? T(1) : T();
+            }
+            const int sweeps = OneSidedJacobi<T,M,N>( w, v, maxSweeps );
+            NormalizeColumns<T,M,N>( w, s, u );
+            return sweeps;
+        }
+    };
+
+    // A^T に対して片側 Jacobi を掛けて U と V を入れ替える
+    template<class T, int M, int N, int K>
+    struct SvdCore<T,M,N,K,false> {
+        static int f( const KMat<T,M,N> &a, KMat<T,M,K> *u, KVec<T,K> &s, KMat<T,N,K> *v, int maxSweeps ) {
+            KMat<T,N,M> w;
+            for( int i=0; i<M; ++i ) for( int j=0; j<N; ++j ) w(j,i) = a(i,j);
+            if( u ) {
+                for( int i=0; i<M; ++i ) for( int j=0; j<M; ++j ) (*u)(i,j) = (i == j) ? T(1) : T();
+            }
+            const int sweeps = OneSidedJacobi<T,N,M>( w, u, maxSweeps );
+            NormalizeColumns<T,N,M>( w, s, v );
+            return sweeps;
+        }
+    };
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 小さな行列の SVD ( 片側 Jacobi 法 )  A = U diag(s) V^T
+/// K = min(M,N) として U は M x K, V は N x K ( 薄い SVD )．特異値は降順
+/// U, V が要らないときは計算しないこともできる
+template<class T, int M, int N>
+class KSvd {
+public:
+    static const int K = M < N ? M : N;
+    /// 巡回数の上限
+    static const int MAX_SWEEPS = 30;
+
+public:
+    KSvd() : m_sweeps(0), m_hasU(false), m_hasV(false) {}
+
+    explicit KSvd( const KMat<T,M,N> &a, bool computeU = true, bool computeV = true ) {
+        Compute(a, computeU, computeV);
+    }
+
+    void Compute( const KMat<T,M,N> &a, bool computeU = true, bool computeV = true ) {
+        m_hasU = computeU;
+        m_hasV = computeV;
+        m_sweeps = Detail::SvdCore<T,M,N,K,(M >= N)>::f( a, computeU ? &m_u : 0, m_s, computeV ? &m_v : 0, MAX_SWEEPS );
+        Sort();
+    }
+
+    /// 特異値 ( 降順 )
+    const KVec<T,K> & Values() const {
+        return m_s;
+    }
+
+    /// 左特異ベクトル ( 列 )
+    const KMat<T,M,K> & MatU() const {
+        return m_u;
+    }
+
+    /// 右特異ベクトル ( 列 )
+    const KMat<T,N,K> & MatV() const {
+        return m_v;
+    }
+
+    int Sweeps() const {
+        return m_sweeps;
+    }
+
+    /// tol より大きい特異値の数．tol < 0 なら max(M,N) * eps * s(0)
+    int Rank( T tol = T(-1) ) const {
+        tol = Tolerance(tol);
+        int r = 0;
+        for( int i=0; i<K; ++i ) if( m_s(i) > tol ) ++r;
+        return r;
+    }
+
+    /// 擬似逆行列 A^+ = V diag(1/s) U^T ( tol 以下の特異値は 0 とみなす )．U, V の両方が必要
+    KMat<T,N,M> PseudoInverse( T tol = T(-1) ) const {
+        tol = Tolerance(tol);
+        KMat<T,N,M> r(T(0));
+        for( int k=0; k<K; ++k ) {
+            if( !(m_s(k) > tol) ) continue;
+            const T inv = T(1) / m_s(k);
+            for( int i=0; i<N; ++i ) {
+                const T vi = m_v(i,k) * inv;
+                for( int j=0; j<M; ++j ) r(i,j) += vi * m_u(j,k);
+            }
+        }
+        return r;
+    }
+
+private:
+    T Tolerance( T tol ) const {
+        return tol < T() ? T(M > N ? M : N) * std::numeric_limits<T>::epsilon() * m_s(0) : tol;
+    }
+
+    // 降順に並べて U, V の列も入れ替える
+    void Sort() {
+        for( int i=0; i<K-1; ++i ) {
+            int k = i;
+            for( int j=i+1; j<K; ++j ) if( m_s(j) > m_s(k) ) k = j;
+            if( k == i ) continue;
+            std::swap( m_s(i), m_s(k) );
+            if( m_hasU ) for( int r=0; r<M; ++r ) std::swap( m_u(r,i), m_u(r,k) );
+            if( m_hasV ) for( int r=0; r<N; ++r ) std::swap( m_v(r,i), m_v(r,k) );
+        }
+    }
+
+private:
+    KVec<T,K>   m_s;
+    KMat<T,M,K> m_u;
+    KMat<T,N,K> m_v;
+    int         m_sweeps;
+    bool        m_hasU;
+    bool        m_hasV;
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+/// svd
+template<class T, int M, int N>
+KSvd<T,M,N> svd( const KMat<T,M,N> &a, bool computeU = true, bool computeV = true ) {
+    return KSvd<T,M,N>(a, computeU, computeV);
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 特異値だけ
+template<class T, int M, int N>
+KVec<T, (M < N ? M : N)> singular_values( const KMat<T,M,N> &a ) {
+    return KSvd<T,M,N>(a, false, false).Values();
+}
+
+} // namespace kblas
+
+/////////////////////////////////////////////////////////////////////////////
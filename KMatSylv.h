@@ -0,0 +1,198 @@
+﻿/////////////////////////////////////////////////////////////////////////////
+/** @file
+    @brief  Sylvester 方程式 A X + X B = C と Lyapunov 方程式 A X + X A^T + Q = 0
+    @author oniprog
+*/
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include "KMat.h"
+#include "KMatBatch.h"
+#include "KMatLU.h"
+#include "KMatSchur.h"
+
+namespace kblas {
+
+namespace Detail {
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 大きさ n ( <= 4 ) の小さな連立方程式を部分ピボット選択で解く ( k は書き換える )
+    template<class T>
+    bool SmallSolve( T k[4][4], T *x, int n ) {
+        for( int c=0; c<n; ++c ) {
+            int p = c;
+            for( int i=c+1; i<n; ++i ) if( std::abs(k[i][c]) > std::abs(k[p][c]) ) p = i;
+            if( k[p][c] == T() ) return false;
+            if( p != c ) {
+                for( int j=0; j<n; ++j ) std::swap( k[c][j], k[p][j] );
+                std::swap( x[c], x[p] );
+            }
+            for( int i=c+1; i<n; ++i ) {
+                const T l = k[i][c] / k[c][c];
+                for( int j=c+1; j<n; ++j ) k[i][j] -= l * k[c][j];
+                x[i] -= l * x[c];
+            }
+        }
+        for( int i=n-1; i>=0; --i ) {
+            for( int j=i+1; j<n; ++j ) x[i] -= k[i][j] * x[j];
+            x[i] /= k[i][i];
+        }
+        return true;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 準上三角 S, T に対する S Y + Y T = F ( Y は F を上書き )
+    // 対角ブロックごとに 1x1 .. 2x2 の小さな Sylvester 方程式を解く ( LAPACK trsyl と同じ順 )
+    template<class T, int N, int M>
+    bool QuasiTriSylvester( const KMat<T,N,N> &s, const KMat<T,M,M> &t, KMat<T,N,M> &f ) {
+        for( int j=0; j<M; ) {
+            const int q = (j+1 < M && t(j+1,j) != T()) ? 2 : 1;
+            for( int ie=N; ie>0; ) {
+                const int p = (ie >= 2 && s(ie-1,ie-2) != T()) ? 2 : 1;
+                const int i = ie - p;
+
+                // 右辺 F_ij - S_i,>i Y_>i,j - Y_i,<j T_<j,j
+                T x[4];
+                for( int c=0; c<q; ++c ) for( int r=0; r<p; ++r ) {
+                    T v = f(i+r,j+c);
+                    for( int k=ie; k<N; ++k ) v -= s(i+r,k) * f(k,j+c);
+                    for( int k=0; k<j; ++k ) v -= f(i+r,k) * t(k,j+c);
+                    x[r + c*p] = v;
+                }
+
+                // ( I ⊗ S_ii + T_jj^T ⊗ I ) vec(Y_ij) = vec(右辺)
+                T k[4][4];
+                for( int a=0; a<4; ++a ) for( int b=0; b<4; ++b ) k[a][b] = T();
+                for( int c=0; c<q; ++c ) for( int r=0; r<p; ++r ) {
+                    for( int kk=0; kk<p; ++kk ) k[r + c*p][kk + c*p] += s(i+r,i+kk);
+                    for( int l=0; l<q; ++l ) k[r + c*p][r + l*p] += t(j+l,j+c);
+                }
+                if( !SmallSolve( k, x, p*q ) ) return false;
+
+                for( int c=0; c<q; ++c ) for( int r=0; r<p; ++r ) f(i+r,j+c) = x[r + c*p];
+                ie = i;
+            }
+            j += q;
+        }
+        return true;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // N*M が小さいときは Kronecker 形 ( I ⊗ A + B^T ⊗ I ) vec(X) = vec(C) を LU で解く
+    // それ以外は Bartels-Stewart ( 両方を実 Schur 形にして準三角の方程式を解く )
+    template<class T, int N, int M, bool SMALL>
+    struct SylvesterImpl {
+        static bool f( const KMat<T,N,N> &a, const KMat<T,M,M> &b, const KMat<T,N,M> &c, KMat<T,N,M> &x ) {
+            const KRealSchur<T,N> sa(a);
+            const KRealSchur<T,M> sb(b);
+            if( !sa.IsOk() || !sb.IsOk() ) return false;
+            const KMat<T,N,N> &u = sa.MatQ();
+            const KMat<T,M,M> &v = sb.MatQ();
+
+            // F = U^T C V
+            const KMat<T,N,M> cv = prod(c, v);
+            KMat<T,N,M> f(T(0));
+            for( int i=0; i<N; ++i ) for( int k=0; k<N; ++k ) {
+                const T uki = u(k,i);
+                for( int j=0; j<M; ++j ) f(i,j) += uki * cv(k,j);
+            }
+            if( !QuasiTriSylvester( sa.MatT(), sb.MatT(), f ) ) return false;
+
+            // X = U Y V^T
+            const KMat<T,N,M> uy = prod(u, f);
+            for( int i=0; i<N; ++i ) for( int j=0; j<M; ++j ) {
+                T s = T();
+                for( int k=0; k<M; ++k ) s += uy(i,k) * v(j,k);
+                x(i,j) = s;
+            }
+            return true;
+        }
+    };
+
+    template<class T, int N, int M>
+    struct SylvesterImpl<T,N,M,true> {
+        static bool f( const KMat<T,N,N> &a, const KMat<T,M,M> &b, const KMat<T,N,M> &c, KMat<T,N,M> &x ) {
+            KMat<T,N*M,N*M> k(T(0));
+            KVec<T,N*M> r;
+            for( int j=0; j<M; ++j ) for( int i=0; i<N; ++i ) {
+                const int row = i + j*N;
+                r(row) = c(i,j);
+                for( int l=0; l<N; ++l ) k(row, l + j*N) += a(i,l);
+                for( int l=0; l<M; ++l ) k(row, i + l*N) += b(l,j);
+            }
+            const KLU<T,N*M> f(k);
+            if( !f.IsOk() ) return false;
+            r = f.Solve(r);
+            for( int j=0; j<M; ++j ) for( int i=0; i<N; ++i ) x(i,j) = r(i + j*N);
+            return true;
+        }
+    };
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// A X + X B = C を解く
+/// 解けない ( A と -B が共通の固有値を持つ ) ときは false を返し，x は変えない
+/// N*M <= 16 は Kronecker 形を LU で，それ以上は Bartels-Stewart で解く．作業領域はすべてスタック上
+template<class T, int N, int M>
+bool sylvester( const KMat<T,N,N> &a, const KMat<T,M,M> &b, const KMat<T,N,M> &c, KMat<T,N,M> &x ) {
+    KMat<T,N,M> r;
+    if( !Detail::SylvesterImpl<T,N,M,(N*M <= 16)>::f(a, b, c, r) ) return false;
+    x = r;
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 連続時間の Lyapunov 方程式 A X + X A^T + Q = 0 を解く
+/// Q が対称なら X も対称になるので，最後に対称化する
+template<class T, int N>
+bool lyapunov( const KMat<T,N,N> &a, const KMat<T,N,N> &q, KMat<T,N,N> &x ) {
+    KMat<T,N,N> at, mq, r;
+    for( int i=0; i<N; ++i ) for( int j=0; j<N; ++j ) {
+        at(i,j) = a(j,i);
+        mq(i,j) = -q(i,j);
+    }
+    if( !Detail::SylvesterImpl<T,N,N,(N*N <= 16)>::f(a, at, mq, r) ) return false;
+    for( int i=0; i<N; ++i ) for( int j=0; j<N; ++j ) x(i,j) = (r(i,j) + r(j,i)) / 2;
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 束ごとに sylvester を解く
+/// ok[b] に解けたかどうかを入れ ( 0 なら入れない )，解けた個数を返す
+/// Schur 分解の反復回数が行列ごとに違うので，束の方向にはベクトル化せず 1 本ずつ解く
+template<class T, int N, int M, int B>
+int sylvester_batch( const KMatBatch<T,N,N,B> &a, const KMatBatch<T,M,M,B> &b, const KMatBatch<T,N,M,B> &c,
+                     KMatBatch<T,N,M,B> &x, bool *ok = 0 ) {
+    int count = 0;
+    for( int l=0; l<B; ++l ) {
+        KMat<T,N,M> r(T(0));
+        const bool f = sylvester( a.Get(l), b.Get(l), c.Get(l), r );
+        x.Set( l, r );
+        if( ok ) ok[l] = f;
+        if( f ) ++count;
+    }
+    return count;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 束ごとに lyapunov を解く ( 戻り値と ok は sylvester_batch と同じ )
+template<class T, int N, int B>
+int lyapunov_batch( const KMatBatch<T,N,N,B> &a, const KMatBatch<T,N,N,B> &q, KMatBatch<T,N,N,B> &x, bool *ok = 0 ) {
+    int count = 0;
+    for( int l=0; l<B; ++l ) {
+        KMat<T,N,N> r(T(0));
+        const bool f = lyapunov( a.Get(l), q.Get(l), r );
+        x.Set( l, r );
+        if( ok ) ok[l] = f;
+        if( f ) ++count;
+    }
+    return count;
+}
+
+} // namespace kblas
+
+/////////////////////////////////////////////////////////////////////////////
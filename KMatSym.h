@@ -0,0 +1,199 @@
+﻿/////////////////////////////////////////////////////////////////////////////
+/** @file
+    @brief  対称行列 ( 上三角を詰めて持つ )
+    @author oniprog
+*/
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "KMat.h"
+
+namespace kblas {
+
+// 対称行列
+// T 型
+// N サイズ
+// 上三角 ( i <= j ) を行ごとに詰めて N(N+1)/2 個だけ持つ
+// (i,j) と (j,i) は同じ要素を指す
+template<class T, int N>
+class KSymMat {
+public:
+    static const int SIZE = N;
+    static const int PACKED = N * (N + 1) / 2;
+public:
+
+    KSymMat() {}
+
+    KSymMat( const T &v ) {
+        for( int k=0; k<PACKED; ++k ) m_v[k] = v;
+    }
+
+    /// KMat の上三角から作る ( 下三角は見ない )
+    explicit KSymMat( const KMat<T,N,N> &m ) {
+        for( int i=0; i<N; ++i ) for( int j=i; j<N; ++j ) m_v[Index(i,j)] = m(i,j);
+    }
+
+    T & operator()(int i, int j) {
+        return i <= j ? m_v[Index(i,j)] : m_v[Index(j,i)];
+    }
+    const T operator()(int i, int j) const {
+        return i <= j ? m_v[Index(i,j)] : m_v[Index(j,i)];
+    }
+
+    /// 詰めた並び ( 0 行目の (0,0)..(0,N-1)，1 行目の (1,1)..(1,N-1)，... )
+    T * Data() {
+        return m_v;
+    }
+    const T * Data() const {
+        return m_v;
+    }
+
+    /// 密な行列にする
+    KMat<T,N,N> Dense() const {
+        KMat<T,N,N> m;
+        for( int i=0; i<N; ++i ) for( int j=i; j<N; ++j ) {
+            m(i,j) = m_v[Index(i,j)];
+            m(j,i) = m_v[Index(i,j)];
+        }
+        return m;
+    }
+
+    KSymMat & operator+=( const KSymMat &m ) {
+        for( int k=0; k<PACKED; ++k ) m_v[k] += m.m_v[k];
+        return *this;
+    }
+    KSymMat & operator-=( const KSymMat &m ) {
+        for( int k=0; k<PACKED; ++k ) m_v[k] -= m.m_v[k];
+        return *this;
+    }
+    KSymMat & operator*=( const T &v ) {
+        for( int k=0; k<PACKED; ++k ) m_v[k] *= v;
+        return *this;
+    }
+
+    /// 上三角 (i,j) ( i <= j ) の詰めた位置
+    static int Index( int i, int j ) {
+        return i * N - i * (i - 1) / 2 + (j - i);
+    }
+
+private:
+    T   m_v[PACKED];
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+/// S v ( 詰めた要素を 1 回ずつ読み，(i,j) と (j,i) の両方に使う )
+template<class T, int N>
+KVec<T,N> prod( const KSymMat<T,N> &s, const KVec<T,N> &v ) {
+    KVec<T,N> r(T(0));
+    const T *p = s.Data();
+    for( int i=0; i<N; ++i ) {
+        const T vi = v(i);
+        T ri = r(i) + *p++ * vi;
+        for( int j=i+1; j<N; ++j ) {
+            const T a = *p++;
+            ri += a * v(j);
+            r(j) += a * vi;
+        }
+        r(i) = ri;
+    }
+    return r;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// S B ( B は N x K )
+template<class T, int N, int K>
+KMat<T,N,K> prod( const KSymMat<T,N> &s, const KMat<T,N,K> &b ) {
+    KMat<T,N,K> r(T(0));
+    const T *p = s.Data();
+    for( int i=0; i<N; ++i ) {
+        const T d = *p++;
+        for( int k=0; k<K; ++k ) r(i,k) += d * b(i,k);
+        for( int j=i+1; j<N; ++j ) {
+            const T a = *p++;
+            for( int k=0; k<K; ++k ) {
+                r(i,k) += a * b(j,k);
+                r(j,k) += a * b(i,k);
+            }
+        }
+    }
+    return r;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// B S ( B は M x N )
+template<class T, int M, int N>
+KMat<T,M,N> prod( const KMat<T,M,N> &b, const KSymMat<T,N> &s ) {
+    KMat<T,M,N> r(T(0));
+    const T *p = s.Data();
+    for( int i=0; i<N; ++i ) {
+        const T d = *p++;
+        for( int m=0; m<M; ++m ) r(m,i) += b(m,i) * d;
+        for( int j=i+1; j<N; ++j ) {
+            const T a = *p++;
+            for( int m=0; m<M; ++m ) {
+                r(m,j) += b(m,i) * a;
+                r(m,i) += b(m,j) * a;
+            }
+        }
+    }
+    return r;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// A += B C B^T ( B は N x K, C は K x K の対称 )
+/// W = B C を作り，A の上三角だけ W B^T を足す
+/// カルマンフィルタの P = F P F^T + Q などに使う
+template<class T, int N, int K>
+void add_congruence( KSymMat<T,N> &a, const KMat<T,N,K> &b, const KSymMat<T,K> &c ) {
+    const KMat<T,N,K> w = prod(b, c);
+    T *p = a.Data();
+    for( int i=0; i<N; ++i ) for( int j=i; j<N; ++j ) {
+        T s = T();
+        for( int k=0; k<K; ++k ) s += w(i,k) * b(j,k);
+        *p++ += s;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// B C B^T
+template<class T, int N, int K>
+KSymMat<T,N> congruence( const KMat<T,N,K> &b, const KSymMat<T,K> &c ) {
+    KSymMat<T,N> r(T(0));
+    add_congruence( r, b, c );
+    return r;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// A += alpha B B^T ( B は N x K )．上三角だけ計算する
+template<class T, int N, int K>
+void rank_update( KSymMat<T,N> &a, const KMat<T,N,K> &b, const T &alpha = T(1) ) {
+    T *p = a.Data();
+    for( int i=0; i<N; ++i ) for( int j=i; j<N; ++j ) {
+        T s = T();
+        for( int k=0; k<K; ++k ) s += b(i,k) * b(j,k);
+        *p++ += alpha * s;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// operator * (S, C)
+template<class T, int N>
+KSymMat<T,N> operator * ( const KSymMat<T,N> &m1, const T &v ) {
+    KSymMat<T,N> ret(m1);
+    ret *= v;
+    return ret;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// operator + (S, S)
+template<class T, int N>
+KSymMat<T,N> operator + ( const KSymMat<T,N> &m1, const KSymMat<T,N> &m2 ) {
+    KSymMat<T,N> ret(m1);
+    ret += m2;
+    return ret;
+}
+
+} // namespace kblas
+
+/////////////////////////////////////////////////////////////////////////////
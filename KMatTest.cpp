@@ -17,6 +17,25 @@
 #endif
 
 #include "KMat.h"
+#include "KMatChol.h"
+#include "KMatQR.h"
+#include "KMatInv.h"
+#include "KMatEigen.h"
+#include "KMatSvd.h"
+#include "KMatLU.h"
+#include "KMatFunc.h"
+#include "KMatSchur.h"
+#include "KMatSylv.h"
+#include "KMatRiccati.h"
+#include "KMatUpdate.h"
+#include "KMatRls.h"
+#include "KMatTri.h"
+#include "KMatBand.h"
+#include "KMatBlock.h"
+#include "KMatBlockSolve.h"
+#include "KMatSym.h"
+#include "KMatTriMat.h"
+#include "KMatSparse.h"
 
 /////////////////////////////////////////////////////////////////////////////
 int main( int argc, char **argv ) {
@@ -328,3 +347,1869 @@ TEST( TestAddMM, Test1 ) {
     EXPECT_NEAR( 6, m1(0,1), 1E-10 );
 }
 
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestCholesky, Test1 ) {
+
+    kblas::KMat<double,3,3> a;
+    a(0,0) = 4;     a(0,1) = 12;    a(0,2) = -16;
+    a(1,0) = 12;    a(1,1) = 37;    a(1,2) = -43;
+    a(2,0) = -16;   a(2,1) = -43;   a(2,2) = 98;
+
+    auto ch = kblas::cholesky(a);
+    ASSERT_TRUE( ch.IsOk() );
+
+    const auto &l = ch.MatL();
+    EXPECT_NEAR( 2, l(0,0), 1E-10 );
+    EXPECT_NEAR( 6, l(1,0), 1E-10 );
+    EXPECT_NEAR( 1, l(1,1), 1E-10 );
+    EXPECT_NEAR( -8, l(2,0), 1E-10 );
+    EXPECT_NEAR( 5, l(2,1), 1E-10 );
+    EXPECT_NEAR( 3, l(2,2), 1E-10 );
+    EXPECT_NEAR( 0, l(0,2), 1E-30 );
+
+    // det = (2*1*3)^2 = 36
+    EXPECT_NEAR( std::log(36.0), ch.LogDet(), 1E-10 );
+
+    kblas::KVec<double,3> b;
+    b(0) = 1;   b(1) = 2;   b(2) = 3;
+    auto x = ch.Solve(b);
+    auto r = kblas::prod(a, x);
+    for( int i=0; i<3; ++i ) EXPECT_NEAR( b(i), r(i), 1E-10 );
+
+    auto inv = kblas::prod(a, ch.Inverse());
+    for( int i=0; i<3; ++i ) for( int j=0; j<3; ++j ) {
+        EXPECT_NEAR( i==j ? 1 : 0, inv(i,j), 1E-10 );
+    }
+
+    a(2,2) = -1;
+    EXPECT_FALSE( kblas::cholesky(a).IsOk() );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestLDLT, Test1 ) {
+
+    kblas::KMat<double,3,3> a;
+    a(0,0) = 4;     a(0,1) = 12;    a(0,2) = -16;
+    a(1,0) = 12;    a(1,1) = 37;    a(1,2) = -43;
+    a(2,0) = -16;   a(2,1) = -43;   a(2,2) = 98;
+
+    auto f = kblas::ldlt(a);
+    ASSERT_TRUE( f.IsOk() );
+    EXPECT_TRUE( f.IsPositive() );
+
+    EXPECT_NEAR( 4, f.VecD()(0), 1E-10 );
+    EXPECT_NEAR( 1, f.VecD()(1), 1E-10 );
+    EXPECT_NEAR( 9, f.VecD()(2), 1E-10 );
+    EXPECT_NEAR( std::log(36.0), f.LogDet(), 1E-10 );
+
+    kblas::KMat<double,3,2> b;
+    b(0,0) = 1;   b(1,0) = 2;   b(2,0) = 3;
+    b(0,1) = -1;  b(1,1) = 0;   b(2,1) = 5;
+    auto x = f.Solve(b);
+    auto r = kblas::prod(a, x);
+    for( int i=0; i<3; ++i ) for( int j=0; j<2; ++j ) {
+        EXPECT_NEAR( b(i,j), r(i,j), 1E-10 );
+    }
+
+    auto inv = kblas::prod(f.Inverse(), a);
+    for( int i=0; i<3; ++i ) for( int j=0; j<3; ++j ) {
+        EXPECT_NEAR( i==j ? 1 : 0, inv(i,j), 1E-10 );
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestQR, Test1 ) {
+
+    // y = 1 + 2 t - 0.5 t^2 に合わせる
+    kblas::KMat<double,6,3> a;
+    kblas::KVec<double,6> b;
+    for( int i=0; i<6; ++i ) {
+        const double t = i * 0.5;
+        a(i,0) = 1; a(i,1) = t; a(i,2) = t * t;
+        b(i) = 1 + 2 * t - 0.5 * t * t;
+    }
+
+    auto f = kblas::qr(a);
+    ASSERT_TRUE( f.IsOk() );
+
+    auto x = f.SolveLeastSquares(b);
+    EXPECT_NEAR( 1, x(0), 1E-10 );
+    EXPECT_NEAR( 2, x(1), 1E-10 );
+    EXPECT_NEAR( -0.5, x(2), 1E-10 );
+
+    // Q R = A, Q^T Q = I
+    auto q = f.ThinQ();
+    auto qr = kblas::prod(q, f.MatR());
+    for( int i=0; i<6; ++i ) for( int j=0; j<3; ++j ) {
+        EXPECT_NEAR( a(i,j), qr(i,j), 1E-10 );
+    }
+    auto qtq = kblas::prod(kblas::trans(q), q);
+    for( int i=0; i<3; ++i ) for( int j=0; j<3; ++j ) {
+        EXPECT_NEAR( i==j ? 1 : 0, qtq(i,j), 1E-10 );
+    }
+
+    // Q Q^T b = b ( 陰的な Q の往復 )
+    auto c = f.ApplyQ(f.ApplyQt(b));
+    for( int i=0; i<6; ++i ) EXPECT_NEAR( b(i), c(i), 1E-10 );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestQR, Test2 ) {
+
+    // 残差が A の列空間に直交する
+    kblas::KMat<double,5,2> a;
+    kblas::KVec<double,5> b;
+    for( int i=0; i<5; ++i ) {
+        a(i,0) = 1; a(i,1) = i;
+        b(i) = (i % 2) ? 1 : -1;
+    }
+    auto x = kblas::solve_least_squares(a, b);
+    auto ax = kblas::prod(a, x);
+    double d0 = 0, d1 = 0;
+    for( int i=0; i<5; ++i ) {
+        d0 += a(i,0) * (b(i) - ax(i));
+        d1 += a(i,1) * (b(i) - ax(i));
+    }
+    EXPECT_NEAR( 0, d0, 1E-10 );
+    EXPECT_NEAR( 0, d1, 1E-10 );
+
+    a(0,1) = a(1,1) = a(2,1) = a(3,1) = a(4,1) = 0;
+    EXPECT_FALSE( kblas::qr(a).IsOk() );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestInverse, Test1 ) {
+
+    kblas::KMat<double,3,3> a;
+    a(0,0) = 2;  a(0,1) = -1; a(0,2) = 0;
+    a(1,0) = -1; a(1,1) = 2;  a(1,2) = -1;
+    a(2,0) = 0;  a(2,1) = -1; a(2,2) = 2;
+
+    EXPECT_NEAR( 4, kblas::det(a), 1E-12 );
+
+    auto r = kblas::prod(a, kblas::inverse(a));
+    for( int i=0; i<3; ++i ) for( int j=0; j<3; ++j ) {
+        EXPECT_NEAR( i==j ? 1 : 0, r(i,j), 1E-12 );
+    }
+
+    kblas::KMat<double,2,2> b;
+    b(0,0) = 1; b(0,1) = 2;
+    b(1,0) = 2; b(1,1) = 4;
+    kblas::KMat<double,2,2> bi(0.0);
+    EXPECT_FALSE( kblas::try_inverse(b, bi) );
+    EXPECT_NEAR( 0, bi(0,0), 1E-30 );
+    b(1,1) = 5;
+    EXPECT_TRUE( kblas::try_inverse(b, bi) );
+    EXPECT_NEAR( 5, bi(0,0), 1E-12 );
+    EXPECT_NEAR( -2, bi(0,1), 1E-12 );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestInverse, Test2 ) {
+
+    // float 4x4 ( SSE が使えるときは SSE の経路 ) と double の結果を比べる
+    kblas::KMat<float,4,4> a;
+    kblas::KMat<double,4,4> ad;
+    const float v[16] = { 4, 1, 0, 2,  1, 5, 1, 0,  0, 1, 6, 1,  2, 0, 1, 7 };
+    for( int i=0; i<4; ++i ) for( int j=0; j<4; ++j ) {
+        a(i,j) = v[i*4+j];
+        ad(i,j) = v[i*4+j];
+    }
+
+    EXPECT_NEAR( kblas::det(ad), kblas::det(a), 1E-2 );
+
+    auto ai = kblas::inverse(a);
+    auto adi = kblas::inverse(ad);
+    for( int i=0; i<4; ++i ) for( int j=0; j<4; ++j ) {
+        EXPECT_NEAR( adi(i,j), ai(i,j), 1E-5 );
+    }
+
+    auto r = kblas::prod(ad, adi);
+    for( int i=0; i<4; ++i ) for( int j=0; j<4; ++j ) {
+        EXPECT_NEAR( i==j ? 1 : 0, r(i,j), 1E-12 );
+    }
+
+    kblas::KMat<float,4,4> s(1.0f);
+    kblas::KMat<float,4,4> si;
+    EXPECT_FALSE( kblas::try_inverse(s, si) );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestInverse, Pose ) {
+
+    // 平行移動の大きい float の姿勢行列 ( det = 1 ) は特異ではない
+    const float c = std::cos(0.3f), s = std::sin(0.3f);
+    kblas::KMat<float,4,4> a(0.0f);
+    a(0,0) = c;  a(0,1) = -s;
+    a(1,0) = s;  a(1,1) = c;
+    a(2,2) = 1;
+    a(0,3) = 1000; a(1,3) = -1000; a(2,3) = 1000;
+    a(3,3) = 1;
+
+    kblas::KMat<float,4,4> ai;
+    EXPECT_TRUE( kblas::try_inverse(a, ai) );
+    // 逆は [ R^T  -R^T t ]
+    EXPECT_NEAR( -(c * 1000 - s * 1000), ai(0,3), 1E-3 );
+    EXPECT_NEAR( -(-s * 1000 - c * 1000), ai(1,3), 1E-3 );
+    EXPECT_NEAR( -1000, ai(2,3), 1E-3 );
+    EXPECT_NEAR( c, ai(0,0), 1E-6 );
+    EXPECT_NEAR( s, ai(0,1), 1E-6 );
+
+    // 要素が大きくても ( 行ノルムの積があふれる大きさでも ) 判定は変わらない
+    const float v[16] = { 4, 1, 0, 2,  1, 5, 1, 0,  0, 1, 6, 1,  2, 0, 1, 7 };
+    kblas::KMat<float,4,4> b, bi;
+    for( int i=0; i<4; ++i ) for( int j=0; j<4; ++j ) b(i,j) = v[i*4+j] * 1E5f;
+    EXPECT_TRUE( kblas::try_inverse(b, bi) );
+    EXPECT_NEAR( 1, kblas::prod(b, bi)(2,2), 1E-4 );
+
+    // 行や列の大きさを変えても特異なものは特異
+    kblas::KMat<float,4,4> z(1.0f);
+    for( int j=0; j<4; ++j ) z(0,j) = 1E4f;
+    for( int i=0; i<4; ++i ) z(i,3) *= 1E-3f;
+    EXPECT_FALSE( kblas::try_inverse(z, bi) );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestInverse, Batch ) {
+
+    kblas::KMatBatch<double,3,3,8> a, r;
+    for( int b=0; b<8; ++b ) {
+        kblas::KMat<double,3,3> m;
+        for( int i=0; i<3; ++i ) for( int j=0; j<3; ++j ) {
+            m(i,j) = (i == j) ? 3.0 + b : 1.0 / (1 + i + j + b);
+        }
+        a.Set(b, m);
+    }
+    a(0,0,7) = a(0,1,7) = a(0,2,7) = 0;
+
+    bool ok[8];
+    EXPECT_EQ( 7, kblas::try_inverse_batch(a, r, ok) );
+    EXPECT_FALSE( ok[7] );
+
+    for( int b=0; b<7; ++b ) {
+        EXPECT_TRUE( ok[b] );
+        auto p = kblas::prod(a.Get(b), r.Get(b));
+        for( int i=0; i<3; ++i ) for( int j=0; j<3; ++j ) {
+            EXPECT_NEAR( i==j ? 1 : 0, p(i,j), 1E-12 );
+        }
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// A V = V diag(w), V^T V = I, w が昇順かを確かめる
+template<class T, int N>
+static void CheckSymEigen( const kblas::KMat<T,N,N> &a, const kblas::KVec<T,N> &w, const kblas::KMat<T,N,N> &v, double tol ) {
+
+    for( int i=0; i<N-1; ++i ) EXPECT_LE( w(i), w(i+1) );
+
+    auto av = kblas::prod(a, v);
+    for( int i=0; i<N; ++i ) for( int j=0; j<N; ++j ) {
+        EXPECT_NEAR( v(i,j) * w(j), av(i,j), tol );
+    }
+    auto vtv = kblas::prod(kblas::trans(v), v);
+    for( int i=0; i<N; ++i ) for( int j=0; j<N; ++j ) {
+        EXPECT_NEAR( i==j ? 1 : 0, vtv(i,j), tol );
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestSymEigen, Test1 ) {
+
+    kblas::KMat<double,6,6> a;
+    for( int i=0; i<6; ++i ) for( int j=0; j<=i; ++j ) {
+        a(i,j) = a(j,i) = (i == j) ? 10.0 - i : 1.0 / (1 + i + j);
+    }
+
+    auto e = kblas::eigen_sym(a);
+    CheckSymEigen( a, e.Values(), e.Vectors(), 1E-12 );
+    EXPECT_LT( 0, e.Sweeps() );
+
+    // 固定回数でも十分に収束している
+    kblas::KSymEigen<double,6> f;
+    f.Compute( a, true, 8 );
+    EXPECT_EQ( 8, f.Sweeps() );
+    for( int i=0; i<6; ++i ) EXPECT_NEAR( e.Values()(i), f.Values()(i), 1E-12 );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestSymEigen, Closed3 ) {
+
+    kblas::KMat<double,3,3> a;
+    a(0,0) = 2;  a(0,1) = -1; a(0,2) = 0;
+    a(1,0) = -1; a(1,1) = 2;  a(1,2) = -1;
+    a(2,0) = 0;  a(2,1) = -1; a(2,2) = 2;
+
+    kblas::KSymEigen<double,3> e;
+    e.ComputeClosed(a);
+    CheckSymEigen( a, e.Values(), e.Vectors(), 1E-10 );
+    EXPECT_NEAR( 2 - std::sqrt(2.0), e.Values()(0), 1E-12 );
+    EXPECT_NEAR( 2, e.Values()(1), 1E-12 );
+    EXPECT_NEAR( 2 + std::sqrt(2.0), e.Values()(2), 1E-12 );
+
+    auto j = kblas::eigen_sym(a);
+    for( int i=0; i<3; ++i ) EXPECT_NEAR( j.Values()(i), e.Values()(i), 1E-12 );
+
+    // 重根
+    kblas::KMat<double,3,3> b(1.0);
+    e.ComputeClosed(b);
+    CheckSymEigen( b, e.Values(), e.Vectors(), 1E-10 );
+    EXPECT_NEAR( 3, e.Values()(2), 1E-12 );
+
+    // 重根 ( 回転した diag(1,1,4) )
+    const double c = std::cos(0.3), s = std::sin(0.3);
+    kblas::KMat<double,3,3> r(0.0), d(0.0);
+    r(0,0) = c;  r(0,1) = -s; r(1,0) = s; r(1,1) = c; r(2,2) = 1;
+    d(0,0) = 1; d(1,1) = 4; d(2,2) = 1;
+    const kblas::KMat<double,3,3> g = kblas::prod( kblas::prod(r, d), kblas::trans(r) );
+    e.ComputeClosed(g);
+    CheckSymEigen( g, e.Values(), e.Vectors(), 1E-10 );
+    EXPECT_NEAR( 1, e.Values()(0), 1E-12 );
+    EXPECT_NEAR( 1, e.Values()(1), 1E-12 );
+    EXPECT_NEAR( 4, e.Values()(2), 1E-12 );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestSymEigen, Batch ) {
+
+    kblas::KMatBatch<double,4,4,8> a, v;
+    kblas::KVecBatch<double,4,8> w;
+    for( int b=0; b<8; ++b ) {
+        kblas::KMat<double,4,4> m;
+        for( int i=0; i<4; ++i ) for( int j=0; j<=i; ++j ) {
+            m(i,j) = m(j,i) = (i == j) ? double(b - i) : 0.5 / (1 + i + j + b);
+        }
+        a.Set(b, m);
+    }
+    kblas::eigen_sym_batch( a, w, &v );
+
+    for( int b=0; b<8; ++b ) {
+        CheckSymEigen( a.Get(b), w.Get(b), v.Get(b), 1E-12 );
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// A = U diag(s) V^T, U と V が回転かを確かめる
+static void CheckSvd3( const kblas::KMat<float,3,3> &a, const kblas::KMat<float,3,3> &u,
+                       const kblas::KVec<float,3> &s, const kblas::KMat<float,3,3> &v ) {
+
+    kblas::KMat<float,3,3> us(u);
+    for( int i=0; i<3; ++i ) for( int j=0; j<3; ++j ) us(i,j) *= s(j);
+    auto r = kblas::prod(us, kblas::trans(v));
+    for( int i=0; i<3; ++i ) for( int j=0; j<3; ++j ) {
+        EXPECT_NEAR( a(i,j), r(i,j), 1E-4 );
+    }
+    auto utu = kblas::prod(kblas::trans(u), u);
+    auto vtv = kblas::prod(kblas::trans(v), v);
+    for( int i=0; i<3; ++i ) for( int j=0; j<3; ++j ) {
+        EXPECT_NEAR( i==j ? 1 : 0, utu(i,j), 1E-5 );
+        EXPECT_NEAR( i==j ? 1 : 0, vtv(i,j), 1E-5 );
+    }
+    EXPECT_NEAR( 1, kblas::det(u), 1E-5 );
+    EXPECT_NEAR( 1, kblas::det(v), 1E-5 );
+    EXPECT_GE( s(0), s(1) );
+    EXPECT_GE( s(1), std::abs(s(2)) );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestSvd3, Test1 ) {
+
+    kblas::KMat<float,3,3> a, u, v;
+    kblas::KVec<float,3> s;
+    a(0,0) = 1;  a(0,1) = 2;   a(0,2) = 3;
+    a(1,0) = 4;  a(1,1) = 5;   a(1,2) = 6;
+    a(2,0) = 7;  a(2,1) = 8;   a(2,2) = 10;
+
+    kblas::svd3(a, u, s, v);
+    CheckSvd3( a, u, s, v );
+    // det(A) = -3 なので最小特異値は負
+    EXPECT_LT( s(2), 0 );
+    EXPECT_NEAR( -3, s(0) * s(1) * s(2), 1E-3 );
+
+    // 対角で順番が逆のもの
+    kblas::KMat<float,3,3> d(0.0f);
+    d(0,0) = 1; d(1,1) = 3; d(2,2) = 2;
+    kblas::svd3(d, u, s, v);
+    CheckSvd3( d, u, s, v );
+    EXPECT_NEAR( 3, s(0), 1E-5 );
+    EXPECT_NEAR( 2, s(1), 1E-5 );
+    EXPECT_NEAR( 1, s(2), 1E-5 );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestSvd3, Batch ) {
+
+    kblas::KMatBatch<float,3,3,16> a, u, v;
+    kblas::KVecBatch<float,3,16> s;
+    for( int b=0; b<16; ++b ) {
+        for( int i=0; i<3; ++i ) for( int j=0; j<3; ++j ) {
+            a(i,j,b) = std::sin( 1.0f + b * 9 + i * 3 + j );
+        }
+    }
+    // 特異なものも混ぜる
+    for( int j=0; j<3; ++j ) a(2,j,5) = a(1,j,5);
+
+    kblas::svd3_batch(a, u, s, v);
+    for( int b=0; b<16; ++b ) {
+        CheckSvd3( a.Get(b), u.Get(b), s.Get(b), v.Get(b) );
+    }
+    EXPECT_NEAR( 0, s(2,5), 1E-4 );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// A = U diag(s) V^T, U^T U = I, V^T V = I
+template<int M, int N, int K>
+static void CheckSvd( const kblas::KMat<double,M,N> &a, const kblas::KMat<double,M,K> &u,
+                      const kblas::KVec<double,K> &s, const kblas::KMat<double,N,K> &v ) {
+
+    kblas::KMat<double,M,K> us(u);
+    for( int i=0; i<M; ++i ) for( int j=0; j<K; ++j ) us(i,j) *= s(j);
+    auto r = kblas::prod(us, kblas::trans(v));
+    for( int i=0; i<M; ++i ) for( int j=0; j<N; ++j ) {
+        EXPECT_NEAR( a(i,j), r(i,j), 1E-12 );
+    }
+    auto utu = kblas::prod(kblas::trans(u), u);
+    auto vtv = kblas::prod(kblas::trans(v), v);
+    for( int i=0; i<K; ++i ) for( int j=0; j<K; ++j ) {
+        EXPECT_NEAR( i==j ? 1 : 0, utu(i,j), 1E-12 );
+        EXPECT_NEAR( i==j ? 1 : 0, vtv(i,j), 1E-12 );
+    }
+    for( int i=0; i<K-1; ++i ) EXPECT_GE( s(i), s(i+1) );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestSvd, Test1 ) {
+
+    kblas::KMat<double,5,3> a;
+    for( int i=0; i<5; ++i ) for( int j=0; j<3; ++j ) a(i,j) = std::cos( 1.0 + i * i + 2 * j * j * (i + 1) );
+
+    auto f = kblas::svd(a);
+    CheckSvd( a, f.MatU(), f.Values(), f.MatV() );
+    EXPECT_EQ( 3, f.Rank() );
+
+    // 特異値だけでも同じ
+    auto s = kblas::singular_values(a);
+    for( int i=0; i<3; ++i ) EXPECT_NEAR( f.Values()(i), s(i), 1E-12 );
+
+    // 横長
+    kblas::KMat<double,3,5> b;
+    for( int i=0; i<5; ++i ) for( int j=0; j<3; ++j ) b(j,i) = a(i,j);
+    auto g = kblas::svd(b);
+    CheckSvd( b, g.MatU(), g.Values(), g.MatV() );
+    for( int i=0; i<3; ++i ) EXPECT_NEAR( f.Values()(i), g.Values()(i), 1E-12 );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestSvd, Rank ) {
+
+    // rank 2 の 4x4
+    kblas::KMat<double,4,4> a;
+    for( int i=0; i<4; ++i ) for( int j=0; j<4; ++j ) a(i,j) = (i + 1) * (j + 2) + (i == 2 ? 0 : 1) * j;
+
+    auto f = kblas::svd(a);
+    CheckSvd( a, f.MatU(), f.Values(), f.MatV() );
+    EXPECT_EQ( 2, f.Rank() );
+
+    // A A^+ A = A
+    auto p = f.PseudoInverse();
+    auto apa = kblas::prod(kblas::prod(a, p), a);
+    for( int i=0; i<4; ++i ) for( int j=0; j<4; ++j ) {
+        EXPECT_NEAR( a(i,j), apa(i,j), 1E-10 );
+    }
+
+    // 零行列でも U, V は直交
+    kblas::KMat<double,3,2> z(0.0);
+    auto g = kblas::svd(z);
+    CheckSvd( z, g.MatU(), g.Values(), g.MatV() );
+    EXPECT_EQ( 0, g.Rank() );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestLU, Test1 ) {
+
+    kblas::KMat<double,4,4> a;
+    for( int i=0; i<4; ++i ) for( int j=0; j<4; ++j ) a(i,j) = std::cos( 1.0 + i * i + 2 * j * (i + 1) );
+    a(0,0) = 0;     // ピボット選択が必要
+
+    auto f = kblas::lu(a);
+    ASSERT_TRUE( f.IsOk() );
+    EXPECT_NEAR( kblas::det(a), f.Det(), 1E-12 );
+
+    kblas::KVec<double,4> b;
+    for( int i=0; i<4; ++i ) b(i) = i + 1;
+    auto r = kblas::prod(a, f.Solve(b));
+    for( int i=0; i<4; ++i ) EXPECT_NEAR( b(i), r(i), 1E-12 );
+
+    auto ai = f.Inverse();
+    auto ci = kblas::inverse(a);
+    for( int i=0; i<4; ++i ) for( int j=0; j<4; ++j ) EXPECT_NEAR( ci(i,j), ai(i,j), 1E-10 );
+
+    kblas::KMat<double,3,3> s(1.0);
+    EXPECT_FALSE( kblas::lu(s).IsOk() );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestExpm, Small ) {
+
+    // 回転の生成子
+    kblas::KMat<double,2,2> a;
+    a(0,0) = 0;     a(0,1) = -0.7;
+    a(1,0) = 0.7;   a(1,1) = 0;
+    auto e = kblas::expm(a);
+    EXPECT_NEAR( std::cos(0.7), e(0,0), 1E-14 );
+    EXPECT_NEAR( -std::sin(0.7), e(0,1), 1E-14 );
+    EXPECT_NEAR( std::sin(0.7), e(1,0), 1E-14 );
+
+    // 冪零
+    kblas::KMat<double,3,3> n(0.0);
+    n(0,1) = 1; n(1,2) = 1;
+    auto en = kblas::expm(n);
+    EXPECT_NEAR( 1, en(0,0), 1E-14 );
+    EXPECT_NEAR( 1, en(0,1), 1E-14 );
+    EXPECT_NEAR( 0.5, en(0,2), 1E-14 );
+    EXPECT_NEAR( 0, en(1,0), 1E-14 );
+
+    // 2x2 の閉じた式と Pade ( 3x3 に埋め込む ) が一致する
+    kblas::KMat<double,2,2> b;
+    b(0,0) = 1.5;   b(0,1) = 2;
+    b(1,0) = -0.5;  b(1,1) = -3;
+    kblas::KMat<double,3,3> b3(0.0);
+    for( int i=0; i<2; ++i ) for( int j=0; j<2; ++j ) b3(i,j) = b(i,j);
+    auto eb = kblas::expm(b);
+    auto eb3 = kblas::expm(b3);
+    for( int i=0; i<2; ++i ) for( int j=0; j<2; ++j ) EXPECT_NEAR( eb3(i,j), eb(i,j), 1E-12 );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestExpm, Fixed3 ) {
+
+    // 3x3 の固定次数と一般の Pade ( 4x4 に埋め込む ) が一致する ( スケーリングなしとありの両方 )
+    const double scales[] = { 0.1, 3.0 };
+    for( int k=0; k<2; ++k ) {
+        kblas::KMat<double,3,3> a;
+        kblas::KMat<double,4,4> a4(0.0);
+        for( int i=0; i<3; ++i ) for( int j=0; j<3; ++j ) {
+            a(i,j) = scales[k] * std::sin( 2.0 + i * 3 + j );
+            a4(i,j) = a(i,j);
+        }
+        auto e = kblas::expm(a);
+        auto e4 = kblas::expm(a4);
+        for( int i=0; i<3; ++i ) for( int j=0; j<3; ++j ) {
+            EXPECT_NEAR( e4(i,j), e(i,j), 1E-12 * (1 + std::abs(e4(i,j))) );
+        }
+    }
+
+    // 回転の生成子 ( Rodrigues の式 )
+    kblas::KMat<float,3,3> w(0.0f);
+    w(0,1) = -0.3f; w(1,0) = 0.3f;
+    w(0,2) = 0.4f;  w(2,0) = -0.4f;
+    auto r = kblas::expm(w);
+    const double th = 0.5;
+    const double c1 = std::sin(th) / th, c2 = (1 - std::cos(th)) / (th * th);
+    auto w2 = kblas::prod(w, w);
+    for( int i=0; i<3; ++i ) for( int j=0; j<3; ++j ) {
+        EXPECT_NEAR( (i == j ? 1 : 0) + c1 * w(i,j) + c2 * w2(i,j), r(i,j), 1E-6 );
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestExpm, Large ) {
+
+    kblas::KMat<double,6,6> a, na;
+    for( int i=0; i<6; ++i ) for( int j=0; j<6; ++j ) {
+        a(i,j) = 2 * std::sin( 1.0 + i * 6 + j );
+        na(i,j) = -a(i,j);
+    }
+
+    // exp(A) exp(-A) = I
+    auto p = kblas::prod( kblas::expm(a), kblas::expm(na) );
+    for( int i=0; i<6; ++i ) for( int j=0; j<6; ++j ) {
+        EXPECT_NEAR( i==j ? 1 : 0, p(i,j), 1E-8 );
+    }
+
+    kblas::KVec<double,6> v;
+    for( int i=0; i<6; ++i ) v(i) = 1.0 / (i + 1);
+    auto ev = kblas::prod( kblas::expm(a), v );
+    auto fv = kblas::expm_multiply( a, v );
+    for( int i=0; i<6; ++i ) EXPECT_NEAR( ev(i), fv(i), 1E-9 * std::abs(ev(i)) + 1E-9 );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestSchur, Test1 ) {
+
+    kblas::KMat<double,7,7> a;
+    for( int i=0; i<7; ++i ) for( int j=0; j<7; ++j ) a(i,j) = std::sin( 1.0 + i * i * 7 + j * j * 3 + i * j );
+
+    kblas::KRealSchur<double,7> s(a);
+    ASSERT_TRUE( s.IsOk() );
+    const kblas::KMat<double,7,7> &t = s.MatT();
+    const kblas::KMat<double,7,7> &q = s.MatQ();
+
+    // 準上三角 ( 2x2 のブロックは続かない )
+    for( int i=0; i<7; ++i ) for( int j=0; j+1<i; ++j ) EXPECT_EQ( 0, t(i,j) );
+    for( int i=0; i+2<7; ++i ) EXPECT_FALSE( t(i+1,i) != 0 && t(i+2,i+1) != 0 );
+
+    // Q T Q^T = A, Q^T Q = I
+    auto qt = kblas::prod(q, t);
+    for( int i=0; i<7; ++i ) for( int j=0; j<7; ++j ) {
+        double r = 0, e = 0;
+        for( int k=0; k<7; ++k ) {
+            r += qt(i,k) * q(j,k);
+            e += q(k,i) * q(k,j);
+        }
+        EXPECT_NEAR( a(i,j), r, 1E-12 );
+        EXPECT_NEAR( i==j ? 1 : 0, e, 1E-13 );
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+template<int N, int M>
+void CheckSylvester( double shift ) {
+
+    kblas::KMat<double,N,N> a;
+    kblas::KMat<double,M,M> b;
+    kblas::KMat<double,N,M> c, x;
+    for( int i=0; i<N; ++i ) for( int j=0; j<N; ++j ) a(i,j) = std::cos( 0.5 + i * 3 + j * j ) + (i==j ? shift : 0);
+    for( int i=0; i<M; ++i ) for( int j=0; j<M; ++j ) b(i,j) = std::sin( 2.0 + i * i + j * 5 );
+    for( int i=0; i<N; ++i ) for( int j=0; j<M; ++j ) c(i,j) = i - 0.5 * j;
+
+    ASSERT_TRUE( kblas::sylvester(a, b, c, x) );
+    auto r1 = kblas::prod(a, x);
+    auto r2 = kblas::prod(x, b);
+    for( int i=0; i<N; ++i ) for( int j=0; j<M; ++j ) EXPECT_NEAR( c(i,j), r1(i,j) + r2(i,j), 1E-11 );
+}
+
+TEST( TestSylvester, Test1 ) {
+    CheckSylvester<3,2>( 1.0 );    // Kronecker 形
+    CheckSylvester<4,4>( 2.0 );
+    CheckSylvester<6,5>( 3.0 );    // Bartels-Stewart
+    CheckSylvester<9,12>( 4.0 );
+
+    // A と -B が共通の固有値を持つと解けない
+    kblas::KMat<double,2,2> a(0.0), b(0.0);
+    a(0,0) = 1; a(1,1) = 2;
+    b(0,0) = -2; b(1,1) = 5;
+    kblas::KMat<double,2,2> c(1.0), x(7.0);
+    EXPECT_FALSE( kblas::sylvester(a, b, c, x) );
+    EXPECT_EQ( 7.0, x(0,0) );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestSylvester, Lyapunov ) {
+
+    const int B = 3;
+    kblas::KMatBatch<double,6,6,B> a, q, x;
+    for( int l=0; l<B; ++l ) {
+        kblas::KMat<double,6,6> al, ql(0.0);
+        for( int i=0; i<6; ++i ) for( int j=0; j<6; ++j ) al(i,j) = std::cos( 1.0 + l + i * 6 + j ) - (i==j ? 3 : 0);
+        for( int i=0; i<6; ++i ) ql(i,i) = 1 + i + l;
+        ql(0,5) = ql(5,0) = 0.5;
+        a.Set( l, al );
+        q.Set( l, ql );
+    }
+
+    bool ok[B];
+    EXPECT_EQ( B, kblas::lyapunov_batch(a, q, x, ok) );
+    for( int l=0; l<B; ++l ) {
+        ASSERT_TRUE( ok[l] );
+        auto al = a.Get(l);
+        auto xl = x.Get(l);
+        auto ql = q.Get(l);
+        auto ax = kblas::prod(al, xl);
+        for( int i=0; i<6; ++i ) for( int j=0; j<6; ++j ) {
+            EXPECT_NEAR( 0, ax(i,j) + ax(j,i) + ql(i,j), 1E-11 );
+            EXPECT_EQ( xl(i,j), xl(j,i) );
+        }
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestDare, Test1 ) {
+
+    // スカラー x = a^2 x - a^2 b^2 x^2 / (r + b^2 x) + q の正の解
+    {
+        kblas::KMat<double,1,1> a(1.2), b(0.5), q(1.0), r(2.0);
+        kblas::KDare<double,1,1> d(a, b, q, r);
+        ASSERT_TRUE( d.IsOk() );
+        // b^2 x^2 + ( r (1 - a^2) - q b^2 ) x - q r = 0
+        const double c1 = 2 * (1 - 1.44) - 0.25, disc = c1 * c1 + 4 * 0.25 * 2;
+        EXPECT_NEAR( (-c1 + std::sqrt(disc)) / 0.5, d.MatX()(0,0), 1E-12 );
+    }
+
+    // 不安定な 4 次の系
+    kblas::KMat<double,4,4> a(0.0), q(0.0);
+    kblas::KMat<double,4,2> b(0.0);
+    kblas::KMat<double,2,2> r(0.0);
+    for( int i=0; i<4; ++i ) {
+        a(i,i) = 1.05;
+        if( i < 3 ) a(i,i+1) = 0.1;
+        q(i,i) = 1 + i;
+    }
+    a(3,0) = -0.2;
+    b(1,0) = 1; b(3,1) = 0.5; b(2,0) = 0.1;
+    r(0,0) = 1; r(1,1) = 2; r(0,1) = r(1,0) = 0.3;
+
+    int iters = 0;
+    double res = 1;
+    auto k = kblas::dare(a, b, q, r, &iters, &res);
+    EXPECT_GT( iters, 0 );
+    EXPECT_LT( res, 1E-12 );
+
+    // Riccati の漸化式を回した値と一致する
+    kblas::KMat<double,4,4> x(q);
+    for( int n=0; n<2000; ++n ) {
+        auto xb = kblas::prod(x, b);
+        kblas::KMat<double,2,2> s(r);
+        kblas::KMat<double,2,4> bxa(0.0);
+        auto xa = kblas::prod(x, a);
+        for( int i=0; i<2; ++i ) for( int j=0; j<2; ++j ) for( int l=0; l<4; ++l ) s(i,j) += b(l,i) * xb(l,j);
+        for( int i=0; i<2; ++i ) for( int j=0; j<4; ++j ) for( int l=0; l<4; ++l ) bxa(i,j) += b(l,i) * xa(l,j);
+        auto kn = kblas::prod( kblas::inverse(s), bxa );
+        kblas::KMat<double,4,4> ab(a);
+        auto bk = kblas::prod(b, kn);
+        for( int i=0; i<4; ++i ) for( int j=0; j<4; ++j ) ab(i,j) -= bk(i,j);
+        auto xab = kblas::prod(x, ab);
+        kblas::KMat<double,4,4> xn(q);
+        for( int i=0; i<4; ++i ) for( int j=0; j<4; ++j ) for( int l=0; l<4; ++l ) xn(i,j) += a(l,i) * xab(l,j);
+        x = xn;
+    }
+    kblas::KDare<double,4,2> d(a, b, q, r);
+    for( int i=0; i<4; ++i ) for( int j=0; j<4; ++j ) EXPECT_NEAR( x(i,j), d.MatX()(i,j), 1E-8 * std::abs(x(i,j)) + 1E-9 );
+    for( int i=0; i<2; ++i ) for( int j=0; j<4; ++j ) EXPECT_EQ( d.MatK()(i,j), k(i,j) );
+
+    // 可安定でない ( 入力が効かない不安定モード )
+    kblas::KMat<double,4,2> b0(0.0);
+    kblas::KDare<double,4,2> d0(a, b0, q, r);
+    EXPECT_FALSE( d0.IsOk() );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestInverseUpdate, Rank1 ) {
+
+    kblas::KMat<double,5,5> a;
+    kblas::KVec<double,5> u, v;
+    for( int i=0; i<5; ++i ) {
+        for( int j=0; j<5; ++j ) a(i,j) = std::cos( 1.0 + i * 5 + j * j ) + (i==j ? 3 : 0);
+        u(i) = 0.3 * i - 0.5;
+        v(i) = std::sin( 1.0 + i );
+    }
+    auto ainv = kblas::lu(a).Inverse();
+    ASSERT_TRUE( kblas::inverse_rank1_update(ainv, u, v) );
+
+    kblas::KMat<double,5,5> b(a);
+    for( int i=0; i<5; ++i ) for( int j=0; j<5; ++j ) b(i,j) += u(i) * v(j);
+    auto binv = kblas::lu(b).Inverse();
+    for( int i=0; i<5; ++i ) for( int j=0; j<5; ++j ) EXPECT_NEAR( binv(i,j), ainv(i,j), 1E-12 );
+
+    // A + e0 (-e0)^T ( A = I ) は特異
+    kblas::KMat<double,3,3> e(0.0);
+    for( int i=0; i<3; ++i ) e(i,i) = 1;
+    kblas::KVec<double,3> e0(0.0), me0(0.0);
+    e0(0) = 1; me0(0) = -1;
+    EXPECT_FALSE( kblas::inverse_rank1_update(e, e0, me0) );
+    EXPECT_EQ( 1, e(0,0) );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+template<int K>
+void CheckWoodbury() {
+
+    kblas::KMat<double,6,6> a;
+    kblas::KMat<double,6,K> u, v;
+    for( int i=0; i<6; ++i ) {
+        for( int j=0; j<6; ++j ) a(i,j) = std::cos( 2.0 + i * 6 + j * j ) + (i==j ? 4 : 0);
+        for( int k=0; k<K; ++k ) {
+            u(i,k) = std::sin( 0.5 + i + 7 * k );
+            v(i,k) = std::cos( 1.5 + 2 * i - k );
+        }
+    }
+    auto ainv = kblas::lu(a).Inverse();
+    ASSERT_TRUE( kblas::inverse_rank_update(ainv, u, v) );
+
+    kblas::KMat<double,6,6> b(a);
+    for( int i=0; i<6; ++i ) for( int j=0; j<6; ++j ) for( int k=0; k<K; ++k ) b(i,j) += u(i,k) * v(j,k);
+    auto binv = kblas::lu(b).Inverse();
+    for( int i=0; i<6; ++i ) for( int j=0; j<6; ++j ) EXPECT_NEAR( binv(i,j), ainv(i,j), 1E-11 );
+}
+
+TEST( TestInverseUpdate, Woodbury ) {
+    CheckWoodbury<1>();
+    CheckWoodbury<3>();
+    CheckWoodbury<5>();     // 容量行列を LU で解く
+
+    // A = 49 I に U = e_k, V = -49 e_k を足すと特異．丸めで S の対角は厳密な 0 にならないが，
+    // rank-1 と同じ相対的な判定でどちらの経路も特異とみなす
+    kblas::KMat<double,6,6> ai(0.0);
+    for( int i=0; i<6; ++i ) ai(i,i) = 1.0 / 49;
+    EXPECT_NE( 0.0, 1 - 49 * ai(0,0) );
+    kblas::KMat<double,6,2> u2(0.0), v2(0.0);
+    kblas::KMat<double,6,5> u5(0.0), v5(0.0);
+    for( int k=0; k<2; ++k ) { u2(k,k) = 1; v2(k,k) = -49; }
+    for( int k=0; k<5; ++k ) { u5(k,k) = 1; v5(k,k) = -49; }
+    kblas::KMat<double,6,6> c(ai);
+    EXPECT_FALSE( kblas::inverse_rank_update(c, u2, v2) );
+    EXPECT_FALSE( kblas::inverse_rank_update(c, u5, v5) );
+    kblas::KVec<double,6> e0(0.0), m49(0.0);
+    e0(0) = 1; m49(0) = -49;
+    EXPECT_FALSE( kblas::inverse_rank1_update(c, e0, m49) );
+    EXPECT_EQ( ai(0,0), c(0,0) );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestCholesky, Update ) {
+
+    kblas::KMat<double,6,6> a;
+    for( int i=0; i<6; ++i ) for( int j=0; j<=i; ++j ) {
+        a(i,j) = a(j,i) = std::cos( 1.0 + i * j + i + j ) + (i==j ? 6 : 0);
+    }
+    kblas::KVec<double,6> x;
+    for( int i=0; i<6; ++i ) x(i) = std::sin( 0.3 + 2 * i );
+
+    auto c = kblas::cholesky(a);
+    ASSERT_TRUE( c.IsOk() );
+    kblas::KMat<double,6,6> l = c.MatL();
+
+    kblas::KMat<double,6,6> ap(a);
+    for( int i=0; i<6; ++i ) for( int j=0; j<6; ++j ) ap(i,j) += x(i) * x(j);
+
+    // 追加は分解し直したものと一致する
+    kblas::chol_update(l, x);
+    auto cp = kblas::cholesky(ap);
+    for( int i=0; i<6; ++i ) for( int j=0; j<=i; ++j ) EXPECT_NEAR( cp.MatL()(i,j), l(i,j), 1E-13 );
+
+    // 削除で元に戻る
+    ASSERT_TRUE( kblas::chol_downdate(l, x) );
+    for( int i=0; i<6; ++i ) for( int j=0; j<=i; ++j ) EXPECT_NEAR( c.MatL()(i,j), l(i,j), 1E-13 );
+
+    // 正定値でなくなる削除は失敗し L は変わらない
+    kblas::KVec<double,6> big(0.0);
+    big(2) = 10;
+    const kblas::KMat<double,6,6> l0(l);
+    EXPECT_FALSE( kblas::chol_downdate(l, big) );
+    for( int i=0; i<6; ++i ) for( int j=0; j<=i; ++j ) EXPECT_EQ( l0(i,j), l(i,j) );
+
+    // クラスから
+    EXPECT_TRUE( c.Update(x) );
+    EXPECT_NEAR( cp.LogDet(), c.LogDet(), 1E-12 );
+    EXPECT_TRUE( c.Downdate(x) );
+    EXPECT_FALSE( c.Downdate(big) );
+
+    // 分解に失敗したものは更新も失敗する
+    kblas::KMat<double,6,6> neg(0.0);
+    for( int i=0; i<6; ++i ) neg(i,i) = i == 3 ? -1 : 1;
+    kblas::KCholesky<double,6> cn(neg);
+    ASSERT_FALSE( cn.IsOk() );
+    EXPECT_FALSE( cn.Update(x) );
+    EXPECT_FALSE( cn.Downdate(x) );
+    EXPECT_FALSE( (kblas::KCholesky<double,6>().Update(x)) );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// 重みつき最小二乗 sum_t c_t (y_t - w^T x_t)^2 の解
+template<int N>
+kblas::KVec<double,N> WeightedLS( const kblas::KVec<double,N> *x, const double *y, const double *c, int n ) {
+    kblas::KMat<double,N,N> r(0.0);
+    kblas::KVec<double,N> b(0.0);
+    for( int t=0; t<n; ++t ) {
+        for( int i=0; i<N; ++i ) {
+            b(i) += c[t] * x[t](i) * y[t];
+            for( int j=0; j<N; ++j ) r(i,j) += c[t] * x[t](i) * x[t](j);
+        }
+    }
+    return kblas::cholesky(r).Solve(b);
+}
+
+TEST( TestRls, Test1 ) {
+
+    const int T = 40;
+    kblas::KVec<double,4> x[T];
+    double y[T], c[T];
+    for( int t=0; t<T; ++t ) {
+        for( int i=0; i<4; ++i ) x[t](i) = std::sin( 1.0 + t * (1.7 + 0.3 * i) + i );
+        y[t] = 0.5 * x[t](0) - 2 * x[t](1) + x[t](3) + 0.1 * std::cos( 3.0 * t );
+    }
+
+    // 忘却係数
+    kblas::KRls<double,4> rls(0.95, 1E10);
+    for( int t=0; t<T; ++t ) rls.Update( x[t], y[t] );
+    for( int t=0; t<T; ++t ) c[t] = std::pow( 0.95, T - 1 - t );
+    auto w = WeightedLS<4>( x, y, c, T );
+    for( int i=0; i<4; ++i ) EXPECT_NEAR( w(i), rls.Weights()(i), 1E-6 );
+
+    // スライディング窓 ( 直近 12 個 )
+    kblas::KRls<double,4,12> win(0.98, 1E10);
+    for( int t=0; t<T; ++t ) win.Update( x[t], y[t] );
+    EXPECT_EQ( 12, win.Count() );
+    for( int t=0; t<12; ++t ) c[t] = std::pow( 0.98, 11 - t );
+    auto ww = WeightedLS<4>( x + T - 12, y + T - 12, c, 12 );
+    for( int i=0; i<4; ++i ) EXPECT_NEAR( ww(i), win.Weights()(i), 1E-6 );
+
+    // 束は 1 本ずつ回したものと同じ
+    const int B = 5;
+    kblas::KRlsBatch<double,4,B> batch(0.95, 1E10);
+    double eb[B];
+    for( int t=0; t<T; ++t ) {
+        kblas::KVecBatch<double,4,B> xb;
+        double yb[B];
+        for( int b=0; b<B; ++b ) {
+            xb.Set( b, x[(t + b) % T] );
+            yb[b] = y[(t + b) % T] * (b + 1);
+        }
+        batch.Update( xb, yb, eb );
+    }
+    for( int b=0; b<B; ++b ) {
+        kblas::KRls<double,4> s(0.95, 1E10);
+        double e = 0;
+        for( int t=0; t<T; ++t ) e = s.Update( x[(t + b) % T], y[(t + b) % T] * (b + 1) );
+        EXPECT_NEAR( e, eb[b], 1E-9 );
+        for( int i=0; i<4; ++i ) EXPECT_NEAR( s.Weights()(i), batch.Weights()(i,b), 1E-9 );
+        for( int i=0; i<4; ++i ) for( int j=0; j<4; ++j ) EXPECT_NEAR( s.MatP()(i,j), batch.MatP()(i,j,b), 1E-9 );
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestLU, Refined ) {
+
+    kblas::KMat<double,8,8> a;
+    kblas::KVec<double,8> xt, b;
+    for( int i=0; i<8; ++i ) {
+        for( int j=0; j<8; ++j ) a(i,j) = std::cos( 1.0 + i * 8 + j * j * 0.7 ) + (i==j ? 2 : 0);
+        xt(i) = 1.0 / (i + 1) + 1E-9 * i;
+    }
+    b = kblas::prod(a, xt);
+
+    kblas::KRefineInfo info;
+    auto x = kblas::solve_refined(a, b, &info);
+    EXPECT_FALSE( info.fallback );
+    EXPECT_GT( info.iterations, 1 );
+    for( int i=0; i<8; ++i ) EXPECT_NEAR( xt(i), x(i), 1E-14 );
+
+    // float では分解できない ( double では特異でない ) ので double に戻る
+    kblas::KMat<double,2,2> s;
+    s(0,0) = 1; s(0,1) = 1;
+    s(1,0) = 1; s(1,1) = 1 + 1E-12;
+    kblas::KVec<double,2> sb;
+    sb(0) = 2; sb(1) = 2 + 1E-12;
+    auto sx = kblas::solve_refined(s, sb, &info);
+    EXPECT_TRUE( info.fallback );
+    EXPECT_NEAR( 1, sx(0), 1E-3 );
+    EXPECT_NEAR( 1, sx(1), 1E-3 );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestLU, RefinedIllCond ) {
+
+    // A = H D H ( H はハウスホルダー，D は 1 から 1E-4 )．cond(A) = 1E4
+    const int N = 8;
+    kblas::KVec<double,N> v;
+    double vv = 0;
+    for( int i=0; i<N; ++i ) {
+        v(i) = std::sin( 0.7 + i * 1.3 );
+        vv += v(i) * v(i);
+    }
+    kblas::KMat<double,N,N> h, d(0.0);
+    for( int i=0; i<N; ++i ) {
+        for( int j=0; j<N; ++j ) h(i,j) = (i == j ? 1 : 0) - 2 * v(i) * v(j) / vv;
+        d(i,i) = std::pow( 10.0, -4.0 * i / (N - 1) );
+    }
+    const kblas::KMat<double,N,N> a = kblas::prod( kblas::prod(h, d), h );
+
+    kblas::KVec<double,N> xt;
+    for( int i=0; i<N; ++i ) xt(i) = std::cos( 0.3 + i );
+    const kblas::KVec<double,N> b = kblas::prod(a, xt);
+
+    // 誤差は cond(A) eps 程度で止まるが，後退誤差は double の精度になる
+    kblas::KRefineInfo info;
+    auto x = kblas::solve_refined(a, b, &info);
+    EXPECT_FALSE( info.fallback );
+    EXPECT_LE( info.backward, 1E-15 );
+    for( int i=0; i<N; ++i ) EXPECT_NEAR( xt(i), x(i), 1E-11 );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+template<int N, int K>
+void CheckTri() {
+
+    // 反対側の三角と ( KUnit なら ) 対角はゴミを入れておく
+    kblas::KMat<double,N,N> lo, up;
+    kblas::KMat<double,N,K> x;
+    for( int i=0; i<N; ++i ) {
+        for( int j=0; j<N; ++j ) {
+            const double v = std::cos( 1.0 + i * 3 + j * 7 ) * 0.5;
+            lo(i,j) = j < i ? v : (j == i ? 2 + v : 99);
+            up(i,j) = j > i ? v : (j == i ? 2 + v : 99);
+        }
+        for( int c=0; c<K; ++c ) x(i,c) = std::sin( 0.3 + i + c * 5 );
+    }
+    kblas::KVec<double,N> xv;
+    for( int i=0; i<N; ++i ) xv(i) = x(i,0);
+
+    // b = A x を作る ( unit なら対角 1 )
+    for( int unit=0; unit<2; ++unit ) {
+        kblas::KMat<double,N,N> l(lo), u(up);
+        for( int i=0; i<N; ++i ) for( int j=0; j<N; ++j ) {
+            if( j > i ) l(i,j) = 0;
+            if( j < i ) u(i,j) = 0;
+            if( unit && i == j ) l(i,j) = u(i,j) = 1;
+        }
+        kblas::KMat<double,N,K> bl = kblas::prod(l, x), bu = kblas::prod(u, x);
+        kblas::KMat<double,N,K> blt = kblas::prod(trans(l), x);
+        kblas::KVec<double,N> vl = kblas::prod(l, xv), vu = kblas::prod(u, xv), vlt = kblas::prod(trans(l), xv);
+
+        if( unit ) {
+            kblas::trsm<kblas::KLower,kblas::KUnit>(lo, bl);
+            kblas::trsm<kblas::KUpper,kblas::KUnit>(up, bu);
+            kblas::trsm_trans<kblas::KLower,kblas::KUnit>(lo, blt);
+            kblas::trsv<kblas::KLower,kblas::KUnit>(lo, vl);
+            kblas::trsv<kblas::KUpper,kblas::KUnit>(up, vu);
+            kblas::trsv_trans<kblas::KLower,kblas::KUnit>(lo, vlt);
+        } else {
+            kblas::trsm<kblas::KLower,kblas::KNonUnit>(lo, bl);
+            kblas::trsm<kblas::KUpper,kblas::KNonUnit>(up, bu);
+            kblas::trsm<kblas::KUpper,kblas::KNonUnit>(trans(lo), blt);     // KMatTrans をそのまま
+            kblas::trsv<kblas::KLower,kblas::KNonUnit>(lo, vl);
+            kblas::trsv<kblas::KUpper,kblas::KNonUnit>(up, vu);
+            kblas::trsv<kblas::KUpper,kblas::KNonUnit>(trans(lo), vlt);
+        }
+        for( int i=0; i<N; ++i ) {
+            for( int c=0; c<K; ++c ) {
+                EXPECT_NEAR( x(i,c), bl(i,c), 1E-12 );
+                EXPECT_NEAR( x(i,c), bu(i,c), 1E-12 );
+                EXPECT_NEAR( x(i,c), blt(i,c), 1E-12 );
+            }
+            EXPECT_NEAR( xv(i), vl(i), 1E-12 );
+            EXPECT_NEAR( xv(i), vu(i), 1E-12 );
+            EXPECT_NEAR( xv(i), vlt(i), 1E-12 );
+        }
+    }
+}
+
+TEST( TestTri, Test1 ) {
+    CheckTri<1,1>();
+    CheckTri<5,3>();      // 展開
+    CheckTri<21,4>();     // ブロック化
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestTri, Trans ) {
+
+    // 正方でない行列の転置
+    kblas::KMat<double,2,3> a;
+    for( int i=0; i<2; ++i ) for( int j=0; j<3; ++j ) a(i,j) = i * 3 + j;
+    kblas::KMat<double,2,3> b = trans(trans(a));
+    for( int i=0; i<2; ++i ) for( int j=0; j<3; ++j ) EXPECT_EQ( a(i,j), b(i,j) );
+
+    // V Mt
+    kblas::KVec<double,3> v;
+    for( int i=0; i<3; ++i ) v(i) = i + 1;
+    auto r = kblas::prod( v, trans(a) );
+    EXPECT_EQ( 8, r(0) );
+    EXPECT_EQ( 26, r(1) );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestBand, Solve ) {
+
+    // 帯幅 (2,3)
+    kblas::KBandMat<double,10,2,3> a(0.0);
+    for( int i=0; i<10; ++i ) for( int off=-2; off<=3; ++off ) {
+        if( i + off < 0 || i + off >= 10 ) continue;
+        a.Ref(i,i+off) = off == 0 ? 6 : std::cos( 1.0 + i * 3 + off );
+    }
+    const kblas::KBandMat<double,10,2,3> &ca = a;
+    EXPECT_EQ( 0, ca(0,5) );     // 帯の外
+    EXPECT_EQ( 0, ca(5,0) );
+    EXPECT_EQ( 0, a(0,5) );      // const でなくても帯の外は 0
+    EXPECT_EQ( 0, a(9,0) );
+    EXPECT_EQ( a.Diag(1)(4), a(4,5) );
+
+    kblas::KVec<double,10> b, x;
+    for( int i=0; i<10; ++i ) b(i) = i - 4.5;
+    x = b;
+    ASSERT_TRUE( kblas::band_solve(a, x) );
+    auto r = kblas::prod(a.Dense(), x);
+    for( int i=0; i<10; ++i ) EXPECT_NEAR( b(i), r(i), 1E-13 );
+
+    // 三重対角
+    kblas::KBandMat<double,16,1,1> t;
+    for( int i=0; i<16; ++i ) {
+        t.Diag(-1)(i) = -1;
+        t.Diag(0)(i) = 2.5 + std::sin(1.0 * i);
+        t.Diag(1)(i) = -1 + 0.1 * i;
+    }
+    kblas::KVec<double,16> tb, tx;
+    for( int i=0; i<16; ++i ) tb(i) = std::cos(0.5 * i);
+    tx = tb;
+    ASSERT_TRUE( kblas::solve_tridiag(t, tx) );
+    auto tr = kblas::prod(t.Dense(), tx);
+    for( int i=0; i<16; ++i ) EXPECT_NEAR( tb(i), tr(i), 1E-13 );
+
+    // ピボットが 0
+    kblas::KBandMat<double,3,1,1> z(1.0);
+    kblas::KVec<double,3> zx(1.0);
+    EXPECT_FALSE( kblas::solve_tridiag(z, zx) );
+    EXPECT_EQ( 1, zx(0) );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestBand, Batch ) {
+
+    const int N = 64, B = 8;
+    kblas::KBandMatBatch<double,N,1,1,B> a;
+    kblas::KVecBatch<double,N,B> x;
+    for( int b=0; b<B; ++b ) {
+        kblas::KBandMat<double,N,1,1> t;
+        kblas::KVec<double,N> r;
+        for( int i=0; i<N; ++i ) {
+            t.Diag(-1)(i) = -1 - 0.1 * b;
+            t.Diag(0)(i) = 3 + std::cos(1.0 * i + b);
+            t.Diag(1)(i) = -0.5;
+            r(i) = std::sin(0.1 * i * (b + 1));
+        }
+        a.Set( b, t );
+        x.Set( b, r );
+    }
+    kblas::KVecBatch<double,N,B> x0(x);
+    kblas::solve_tridiag_batch(a, x);
+
+    for( int b=0; b<B; ++b ) {
+        kblas::KVec<double,N> s = x0.Get(b);
+        ASSERT_TRUE( kblas::solve_tridiag(a.Get(b), s) );
+        for( int i=0; i<N; ++i ) EXPECT_NEAR( s(i), x(i,b), 1E-13 );
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// ランク落ちした行列の擬似逆行列を SVD と比べる
+template<int M, int N, int R>
+void CheckCOD() {
+
+    // R 個の外積の和で作る
+    kblas::KMat<double,M,N> a(0.0);
+    for( int r=0; r<R; ++r ) for( int i=0; i<M; ++i ) for( int j=0; j<N; ++j ) {
+        a(i,j) += std::cos( 1.0 + i * (1.3 + r) ) * std::sin( 0.5 + j * (0.7 + 0.9 * r) );
+    }
+
+    kblas::KCOD<double,M,N> c(a);
+    EXPECT_EQ( R, c.Rank() );
+
+    auto p = c.PseudoInverse();
+    auto ps = kblas::svd(a).PseudoInverse();
+    for( int i=0; i<N; ++i ) for( int j=0; j<M; ++j ) EXPECT_NEAR( ps(i,j), p(i,j), 1E-10 );
+
+    kblas::KVec<double,M> b;
+    for( int i=0; i<M; ++i ) b(i) = i - 1.0;
+    auto x = kblas::solve_min_norm(a, b);
+    auto xs = kblas::prod(ps, b);
+    for( int i=0; i<N; ++i ) EXPECT_NEAR( xs(i), x(i), 1E-10 );
+}
+
+TEST( TestCOD, Test1 ) {
+    CheckCOD<6,4,2>();
+    CheckCOD<3,5,2>();
+    CheckCOD<5,5,5>();
+    CheckCOD<4,3,3>();
+
+    // 0 行列
+    kblas::KMat<double,2,3> z(0.0);
+    kblas::KCOD<double,2,3> cz(z);
+    EXPECT_EQ( 0, cz.Rank() );
+    auto pz = kblas::pinv(z);
+    for( int i=0; i<3; ++i ) for( int j=0; j<2; ++j ) EXPECT_EQ( 0, pz(i,j) );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestSchur, Eigenvalues ) {
+
+    // 固有値が分かっている行列を相似変換で作る
+    // 実数 -3, 0.5, 2 と 1 +- 2i, -0.5 +- 0.25i
+    kblas::KMat<double,7,7> d(0.0);
+    d(0,0) = -3; d(1,1) = 0.5; d(2,2) = 2;
+    d(3,3) = 1;  d(3,4) = 2;  d(4,3) = -2; d(4,4) = 1;
+    d(5,5) = -0.5; d(5,6) = 0.25; d(6,5) = -0.25; d(6,6) = -0.5;
+
+    kblas::KMat<double,7,7> s;
+    for( int i=0; i<7; ++i ) for( int j=0; j<7; ++j ) s(i,j) = std::cos( 1.0 + i * i + j * 3 ) + (i==j ? 2 : 0);
+    auto a = kblas::prod( kblas::prod(s, d), kblas::lu(s).Inverse() );
+
+    bool ok = false;
+    auto w = kblas::eigenvalues(a, &ok);
+    ASSERT_TRUE( ok );
+    auto ws = kblas::real_schur(a, false).Eigenvalues();
+
+    const double re[] = { -3, 0.5, 2, 1, 1, -0.5, -0.5 };
+    const double im[] = { 0, 0, 0, 2, -2, 0.25, -0.25 };
+    for( int k=0; k<7; ++k ) {
+        // どこかに一致するものがある
+        double best = 1E9, bests = 1E9;
+        for( int i=0; i<7; ++i ) {
+            best = std::min( best, std::abs( w(i) - std::complex<double>(re[k], im[k]) ) );
+            bests = std::min( bests, std::abs( ws(i) - std::complex<double>(re[k], im[k]) ) );
+        }
+        EXPECT_LT( best, 1E-10 );
+        EXPECT_LT( bests, 1E-10 );
+    }
+
+    // スペクトル半径 ( 最大は -3 )
+    int it = 0;
+    EXPECT_NEAR( 3, kblas::spectral_radius(a, 1000, -1.0, &it), 1E-8 );
+    EXPECT_GT( it, 0 );
+
+    // 最大が共役な組 ( 1 +- 2i, |.| = sqrt(5) )
+    d(0,0) = -1.5;
+    auto a2 = kblas::prod( kblas::prod(s, d), kblas::lu(s).Inverse() );
+    EXPECT_NEAR( std::sqrt(5.0), kblas::spectral_radius(a2), 1E-8 );
+
+    // べき零
+    kblas::KMat<double,3,3> n(0.0);
+    n(0,1) = 1; n(1,2) = 1;
+    EXPECT_EQ( 0, kblas::spectral_radius(n) );
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestExpm, SqrtLog ) {
+
+    // 固有値が正の実数になる 3x3 と，固有値が複素数になる 6x6
+    kblas::KMat<double,3,3> a;
+    a(0,0) = 4;   a(0,1) = 1;   a(0,2) = 0.5;
+    a(1,0) = -1;  a(1,1) = 3;   a(1,2) = 0.2;
+    a(2,0) = 0.3; a(2,1) = 0.1; a(2,2) = 2;
+    bool ok = false;
+    int it = 0;
+    auto s = kblas::sqrtm( a, &ok, 50, &it );
+    ASSERT_TRUE( ok );
+    EXPECT_LT( it, 15 );
+    auto s2 = kblas::prod(s, s);
+    for( int i=0; i<3; ++i ) for( int j=0; j<3; ++j ) EXPECT_NEAR( a(i,j), s2(i,j), 1E-12 );
+
+    // exp(log(A)) = A
+    auto l = kblas::logm( a, &ok );
+    ASSERT_TRUE( ok );
+    auto el = kblas::expm(l);
+    for( int i=0; i<3; ++i ) for( int j=0; j<3; ++j ) EXPECT_NEAR( a(i,j), el(i,j), 1E-12 );
+
+    kblas::KMat<double,6,6> b;
+    for( int i=0; i<6; ++i ) for( int j=0; j<6; ++j ) b(i,j) = 0.4 * std::sin( 1.0 + i * 5 + j * j ) + (i == j ? 2 : 0);
+    auto sb = kblas::sqrtm( b, &ok );
+    ASSERT_TRUE( ok );
+    auto sb2 = kblas::prod(sb, sb);
+    for( int i=0; i<6; ++i ) for( int j=0; j<6; ++j ) EXPECT_NEAR( b(i,j), sb2(i,j), 1E-12 );
+
+    // log(exp(X)) = X ( 固有値の虚部が pi より小さい X )
+    kblas::KMat<double,6,6> x;
+    for( int i=0; i<6; ++i ) for( int j=0; j<6; ++j ) x(i,j) = 0.3 * std::cos( 2.0 + i * 3 + j * j * 2 );
+    auto lx = kblas::logm( kblas::expm(x), &ok );
+    ASSERT_TRUE( ok );
+    for( int i=0; i<6; ++i ) for( int j=0; j<6; ++j ) EXPECT_NEAR( x(i,j), lx(i,j), 1E-11 );
+
+    // 負の固有値には実数の主平方根がない
+    kblas::KMat<double,2,2> n(0.0);
+    n(0,0) = -1;  n(1,1) = 2;
+    kblas::sqrtm( n, &ok );
+    EXPECT_FALSE( ok );
+    kblas::logm( n, &ok );
+    EXPECT_FALSE( ok );
+
+    // 束
+    kblas::KMatBatch<double,3,3,4> ab, rb;
+    for( int l=0; l<4; ++l ) {
+        kblas::KMat<double,3,3> m(a);
+        m(0,0) += l;
+        ab.Set( l, m );
+    }
+    EXPECT_EQ( 4, kblas::sqrtm_batch( ab, rb ) );
+    for( int l=0; l<4; ++l ) {
+        auto r = rb.Get(l);
+        auto r2 = kblas::prod(r, r);
+        EXPECT_NEAR( a(0,0) + l, r2(0,0), 1E-12 );
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestExpm, Polar ) {
+
+    // ずれた回転を戻す
+    kblas::KMat<double,3,3> w(0.0);
+    w(0,1) = -0.3;  w(1,0) = 0.3;
+    w(0,2) = 0.2;   w(2,0) = -0.2;
+    w(1,2) = -0.5;  w(2,1) = 0.5;
+    const auto rot = kblas::expm(w);
+    kblas::KMat<double,3,3> r(rot);
+    for( int i=0; i<3; ++i ) for( int j=0; j<3; ++j ) r(i,j) += 1E-4 * std::sin( 1.0 + i * 3 + j );
+    kblas::orthonormalize( r );
+    auto g = kblas::prod( kblas::trans(r), r );
+    for( int i=0; i<3; ++i ) for( int j=0; j<3; ++j ) {
+        EXPECT_NEAR( i==j ? 1 : 0, g(i,j), 1E-14 );
+        EXPECT_NEAR( rot(i,j), r(i,j), 1E-3 );
+    }
+
+    // 一般の行列 A = U H
+    kblas::KMat<double,5,5> a;
+    for( int i=0; i<5; ++i ) for( int j=0; j<5; ++j ) a(i,j) = 3 * std::sin( 1.0 + i * 7 + j * j ) + (i == j ? 1 : 0);
+    kblas::KMat<double,5,5> u, h;
+    ASSERT_TRUE( kblas::polar( a, u, &h ) );
+    auto uh = kblas::prod(u, h);
+    auto uu = kblas::prod( kblas::trans(u), u );
+    for( int i=0; i<5; ++i ) for( int j=0; j<5; ++j ) {
+        EXPECT_NEAR( a(i,j), uh(i,j), 1E-12 );
+        EXPECT_NEAR( i==j ? 1 : 0, uu(i,j), 1E-14 );
+    }
+    // H は半正定値
+    kblas::KVec<double,5> v;
+    for( int i=0; i<5; ++i ) v(i) = std::cos( 1.0 + i );
+    auto hv = kblas::prod(h, v);
+    double vhv = 0;
+    for( int i=0; i<5; ++i ) vhv += v(i) * hv(i);
+    EXPECT_GT( vhv, 0 );
+
+    // 束は 1 本ずつ求めたものと同じ
+    kblas::KMatBatch<double,5,5,3> ab, ub;
+    for( int l=0; l<3; ++l ) {
+        kblas::KMat<double,5,5> m(a);
+        m(l,l) += 2;
+        ab.Set( l, m );
+    }
+    ASSERT_TRUE( kblas::polar_batch( ab, ub ) );
+    for( int l=0; l<3; ++l ) {
+        kblas::KMat<double,5,5> ul;
+        kblas::polar( ab.Get(l), ul );
+        auto got = ub.Get(l);
+        for( int i=0; i<5; ++i ) for( int j=0; j<5; ++j ) EXPECT_NEAR( ul(i,j), got(i,j), 1E-13 );
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestQR, UpdateRow ) {
+
+    const int M = 9;
+    kblas::KMat<double,M,4> a;
+    kblas::KVec<double,M> b;
+    for( int i=0; i<M; ++i ) {
+        for( int j=0; j<4; ++j ) a(i,j) = std::sin( 1.0 + i * (j + 1) * 0.7 + j * j );
+        b(i) = std::cos( 0.5 + i );
+    }
+
+    // 先頭 5 行で分解し，残りを 1 行ずつ足す
+    kblas::KMat<double,5,4> a5;
+    kblas::KVec<double,5> b5;
+    for( int i=0; i<5; ++i ) {
+        for( int j=0; j<4; ++j ) a5(i,j) = a(i,j);
+        b5(i) = b(i);
+    }
+    auto f5 = kblas::qr(a5);
+    kblas::KMat<double,4,4> r = f5.MatR();
+    kblas::KVec<double,4> qtb;
+    auto c5 = f5.ApplyQt(b5);
+    for( int i=0; i<4; ++i ) qtb(i) = c5(i);
+
+    for( int i=5; i<M; ++i ) {
+        kblas::KVec<double,4> x;
+        for( int j=0; j<4; ++j ) x(j) = a(i,j);
+        kblas::qr_append_row( r, qtb, x, b(i) );
+    }
+
+    // R^T R = A^T A と最小二乗解
+    auto ata = kblas::prod( kblas::trans(a), a );
+    auto rtr = kblas::prod( kblas::trans(r), r );
+    for( int i=0; i<4; ++i ) for( int j=0; j<4; ++j ) EXPECT_NEAR( ata(i,j), rtr(i,j), 1E-12 );
+    for( int i=1; i<4; ++i ) for( int j=0; j<i; ++j ) EXPECT_EQ( 0, r(i,j) );
+
+    auto ls = kblas::solve_least_squares(a, b);
+    kblas::KVec<double,4> xs(qtb);
+    kblas::trsv<kblas::KUpper,kblas::KNonUnit>( r, xs );
+    for( int i=0; i<4; ++i ) EXPECT_NEAR( ls(i), xs(i), 1E-12 );
+
+    // 先頭の行を除く
+    kblas::KVec<double,4> x0;
+    for( int j=0; j<4; ++j ) x0(j) = a(0,j);
+    ASSERT_TRUE( kblas::qr_remove_row( r, qtb, x0, b(0) ) );
+
+    kblas::KMat<double,M-1,4> a1;
+    kblas::KVec<double,M-1> b1;
+    for( int i=1; i<M; ++i ) {
+        for( int j=0; j<4; ++j ) a1(i-1,j) = a(i,j);
+        b1(i-1) = b(i);
+    }
+    auto ata1 = kblas::prod( kblas::trans(a1), a1 );
+    rtr = kblas::prod( kblas::trans(r), r );
+    for( int i=0; i<4; ++i ) for( int j=0; j<4; ++j ) EXPECT_NEAR( ata1(i,j), rtr(i,j), 1E-12 );
+    auto ls1 = kblas::solve_least_squares(a1, b1);
+    kblas::KVec<double,4> xs1(qtb);
+    kblas::trsv<kblas::KUpper,kblas::KNonUnit>( r, xs1 );
+    for( int i=0; i<4; ++i ) EXPECT_NEAR( ls1(i), xs1(i), 1E-10 );
+
+    // 4 行しかない R から行を除くとランクが落ちる
+    kblas::KMat<double,4,4> a4;
+    for( int i=0; i<4; ++i ) for( int j=0; j<4; ++j ) a4(i,j) = a(i,j);
+    kblas::KMat<double,4,4> r4 = kblas::qr(a4).MatR();
+    const kblas::KMat<double,4,4> keep(r4);
+    ASSERT_FALSE( kblas::qr_remove_row( r4, x0 ) );
+    for( int i=0; i<4; ++i ) for( int j=0; j<4; ++j ) EXPECT_EQ( keep(i,j), r4(i,j) );
+
+    // 行の回転 ( float は SSE の経路 )
+    kblas::KMat<float,2,7> g;
+    for( int j=0; j<7; ++j ) {
+        g(0,j) = float(j + 1);
+        g(1,j) = float(2 * j - 3);
+    }
+    float c, s;
+    const float h = kblas::givens( g(0,0), g(1,0), c, s );
+    kblas::rot_rows( g, 0, 1, c, s );
+    EXPECT_NEAR( h, g(0,0), 1E-6 );
+    EXPECT_NEAR( 0, g(1,0), 1E-6 );
+    for( int j=0; j<7; ++j ) {
+        const float n0 = float(j + 1) * (j + 1) + float(2 * j - 3) * (2 * j - 3);
+        EXPECT_NEAR( n0, g(0,j) * g(0,j) + g(1,j) * g(1,j), 1E-4 );
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestBlock, Test1 ) {
+
+    kblas::KMat<double,5,6> a;
+    kblas::KMat<double,6,4> b;
+    for( int i=0; i<5; ++i ) for( int j=0; j<6; ++j ) a(i,j) = 10 * i + j;
+    for( int i=0; i<6; ++i ) for( int j=0; j<4; ++j ) b(i,j) = std::sin( 1.0 + i * 4 + j );
+
+    // 読み出し
+    auto blk = kblas::block<1,2,3,2>(a);
+    EXPECT_EQ( 12, blk(0,0) );
+    EXPECT_EQ( 33, blk(2,1) );
+    const kblas::KMat<double,5,6> &ca = a;
+    auto cb = kblas::block<1,2,3,2>(ca);
+    auto ev = cb.Eval();
+    for( int i=0; i<3; ++i ) for( int j=0; j<2; ++j ) EXPECT_EQ( a(1+i,2+j), ev(i,j) );
+
+    // ブロックの積は，コピーしてからの積と同じ
+    auto p1 = kblas::prod( kblas::block<0,1,5,3>(a), kblas::block<2,1,3,2>(b) );
+    auto p2 = kblas::prod( kblas::block<0,1,5,3>(a).Eval(), kblas::block<2,1,3,2>(b).Eval() );
+    for( int i=0; i<5; ++i ) for( int j=0; j<2; ++j ) EXPECT_EQ( p2(i,j), p1(i,j) );
+
+    kblas::KMat<double,2,5> c;
+    for( int i=0; i<2; ++i ) for( int j=0; j<5; ++j ) c(i,j) = i - j;
+    auto p3 = kblas::prod( c, kblas::block<0,0,5,3>(a) );
+    auto p4 = kblas::prod( c, kblas::block<0,0,5,3>(a).Eval() );
+    for( int i=0; i<2; ++i ) for( int j=0; j<3; ++j ) EXPECT_EQ( p4(i,j), p3(i,j) );
+
+    // 行・列・対角
+    auto v1 = kblas::prod( a, kblas::col<2>(b) );
+    auto v2 = kblas::prod( a, kblas::col<2>(b).Eval() );
+    for( int i=0; i<5; ++i ) EXPECT_EQ( v2(i), v1(i) );
+    auto v3 = kblas::prod( kblas::row<3>(a), b );
+    auto v4 = kblas::prod( kblas::row<3>(a).Eval(), b );
+    for( int j=0; j<4; ++j ) EXPECT_EQ( v4(j), v3(j) );
+    auto d = kblas::diagonal(a);
+    const int dn = d.SIZE;
+    EXPECT_EQ( 5, dn );
+    EXPECT_EQ( 44, d(4) );
+
+    // 書き込みは元の行列に届く
+    kblas::KMat<double,4,4> m(0.0);
+    kblas::KMat<double,2,2> e;
+    e(0,0) = 1; e(0,1) = 2;
+    e(1,0) = 3; e(1,1) = 4;
+    kblas::block<2,2,2,2>(m) = e;
+    kblas::block<0,0,2,2>(m) += kblas::block<2,2,2,2>(m);
+    kblas::block<0,0,2,2>(m) *= 2.0;
+    kblas::block<0,2,2,2>(m) += kblas::prod( e, e );
+    EXPECT_EQ( 2, m(2,3) );
+    EXPECT_EQ( 6, m(1,0) );
+    EXPECT_EQ( 8, m(1,1) );
+    EXPECT_EQ( 10, m(0,3) );
+    EXPECT_EQ( 0, m(3,0) );
+
+    kblas::row<3>(m) = 1.0;
+    kblas::col<0>(m) += kblas::row<3>(m);
+    kblas::diagonal(m) *= 10.0;
+    EXPECT_EQ( 30, m(0,0) );
+    EXPECT_EQ( 7, m(1,0) );
+    EXPECT_EQ( 10, m(3,3) );
+
+    // ブロックのブロックとスカラー倍
+    auto inner = kblas::block<1,1,1,2>( kblas::block<1,2,3,3>(a) );
+    EXPECT_EQ( 23, inner(0,0) );
+    auto s = kblas::block<1,1,1,2>( kblas::block<1,2,3,3>(ca) ) * 2.0;
+    EXPECT_EQ( 48, s(0,1) );
+
+    kblas::KMat<double,3,2> acc(0.0);
+    acc += kblas::block<0,0,3,2>(a);
+    acc -= kblas::block<1,0,3,2>(a);
+    EXPECT_EQ( -10, acc(2,1) );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestBlockSolve, Test1 ) {
+
+    // 6 + 3 に分割した 9x9
+    kblas::KMat<double,9,9> a, s;
+    for( int i=0; i<9; ++i ) for( int j=0; j<9; ++j ) {
+        a(i,j) = std::sin( 1.0 + i * 9 + j * j * 0.5 ) + (i == j ? 4 : 0);
+    }
+    s = kblas::prod( a, kblas::trans(a) );
+    for( int i=0; i<9; ++i ) s(i,i) += 1;
+
+    kblas::KVec<double,9> b;
+    for( int i=0; i<9; ++i ) b(i) = std::cos( 0.3 + i );
+
+    auto ref = kblas::KLU<double,9>(a).Solve(b);
+    kblas::KVec<double,9> x(b);
+    ASSERT_TRUE( kblas::block_solve<6>( a, x ) );
+    for( int i=0; i<9; ++i ) EXPECT_NEAR( ref(i), x(i), 1E-12 );
+
+    kblas::KMat<double,9,9> inv;
+    ASSERT_TRUE( kblas::block_inverse<6>( a, inv ) );
+    auto e = kblas::prod( a, inv );
+    for( int i=0; i<9; ++i ) for( int j=0; j<9; ++j ) EXPECT_NEAR( i==j ? 1 : 0, e(i,j), 1E-12 );
+
+    // 対称正定値は Cholesky
+    auto refs = kblas::KLU<double,9>(s).Solve(b);
+    kblas::KVec<double,9> xs(b);
+    ASSERT_TRUE( kblas::block_solve_spd<6>( s, xs ) );
+    for( int i=0; i<9; ++i ) EXPECT_NEAR( refs(i), xs(i), 1E-12 );
+    ASSERT_TRUE( kblas::block_inverse_spd<3>( s, inv ) );
+    e = kblas::prod( s, inv );
+    for( int i=0; i<9; ++i ) for( int j=0; j<9; ++j ) EXPECT_NEAR( i==j ? 1 : 0, e(i,j), 1E-11 );
+
+    // 複数右辺
+    kblas::KBlockSolver<double,6,3> f(a);
+    ASSERT_TRUE( f.IsOk() );
+    kblas::KMat<double,9,2> bm;
+    for( int i=0; i<9; ++i ) {
+        bm(i,0) = b(i);
+        bm(i,1) = i;
+    }
+    auto xm = f.Solve(bm);
+    auto rm = kblas::prod( a, xm );
+    for( int i=0; i<9; ++i ) for( int j=0; j<2; ++j ) EXPECT_NEAR( bm(i,j), rm(i,j), 1E-12 );
+
+    // A11 が特異なら解かない
+    kblas::KMat<double,4,4> z(1.0);
+    z(2,2) = 3;  z(3,3) = 5;
+    kblas::KVec<double,4> xz(1.0);
+    EXPECT_FALSE( kblas::block_solve<2>( z, xz ) );
+    EXPECT_EQ( 1, xz(0) );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestSymMat, Test1 ) {
+
+    kblas::KMat<double,5,5> d;
+    for( int i=0; i<5; ++i ) for( int j=i; j<5; ++j ) {
+        d(i,j) = std::sin( 1.0 + i * 5 + j );
+        d(j,i) = d(i,j);
+    }
+    kblas::KSymMat<double,5> s(d);
+    const int packed = kblas::KSymMat<double,5>::PACKED;
+    EXPECT_EQ( 15, packed );
+    EXPECT_EQ( d(3,1), s(1,3) );
+    EXPECT_EQ( d(3,1), s(3,1) );
+    s(4,2) = 7;
+    EXPECT_EQ( 7, s(2,4) );
+    s(4,2) = d(4,2);
+
+    auto dd = s.Dense();
+    for( int i=0; i<5; ++i ) for( int j=0; j<5; ++j ) EXPECT_EQ( d(i,j), dd(i,j) );
+
+    // 積は密な行列と同じ
+    kblas::KVec<double,5> v;
+    kblas::KMat<double,5,3> b;
+    kblas::KMat<double,2,5> c;
+    for( int i=0; i<5; ++i ) {
+        v(i) = std::cos( 0.5 + i );
+        for( int k=0; k<3; ++k ) b(i,k) = std::sin( 2.0 + i * 3 + k );
+        for( int k=0; k<2; ++k ) c(k,i) = std::cos( 1.0 + i * 2 + k );
+    }
+    auto sv = kblas::prod(s, v);
+    auto dv = kblas::prod(d, v);
+    for( int i=0; i<5; ++i ) EXPECT_NEAR( dv(i), sv(i), 1E-14 );
+    auto sb = kblas::prod(s, b);
+    auto db = kblas::prod(d, b);
+    for( int i=0; i<5; ++i ) for( int k=0; k<3; ++k ) EXPECT_NEAR( db(i,k), sb(i,k), 1E-14 );
+    auto cs = kblas::prod(c, s);
+    auto cd = kblas::prod(c, d);
+    for( int k=0; k<2; ++k ) for( int i=0; i<5; ++i ) EXPECT_NEAR( cd(k,i), cs(k,i), 1E-14 );
+
+    // P = F P F^T + Q
+    kblas::KMat<double,3,5> f;
+    for( int i=0; i<3; ++i ) for( int j=0; j<5; ++j ) f(i,j) = std::sin( 0.7 * i + 1.3 * j );
+    kblas::KSymMat<double,3> q(0.0);
+    for( int i=0; i<3; ++i ) q(i,i) = 0.1 * (i + 1);
+    auto ref = kblas::prod( kblas::prod(f, d), kblas::trans(f) );
+    kblas::add_congruence( q, f, s );
+    for( int i=0; i<3; ++i ) for( int j=0; j<3; ++j ) {
+        EXPECT_NEAR( ref(i,j) + (i == j ? 0.1 * (i + 1) : 0), q(i,j), 1E-13 );
+    }
+    auto fsf = kblas::congruence( f, s );
+    EXPECT_NEAR( ref(0,2), fsf(2,0), 1E-13 );
+
+    // A + 2 B B^T
+    kblas::KSymMat<double,5> r(s);
+    kblas::rank_update( r, b, 2.0 );
+    auto bbt = kblas::prod( b, kblas::trans(b) );
+    for( int i=0; i<5; ++i ) for( int j=0; j<5; ++j ) EXPECT_NEAR( d(i,j) + 2 * bbt(i,j), r(i,j), 1E-14 );
+
+    auto s2 = s + s * 2.0;
+    EXPECT_NEAR( 3 * d(1,4), s2(4,1), 1E-15 );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+template<kblas::KUplo UPLO>
+void CheckTriMat() {
+
+    kblas::KMat<double,6,6> d(0.0);
+    for( int i=0; i<6; ++i ) for( int j=0; j<6; ++j ) {
+        if( UPLO == kblas::KUpper ? i <= j : i >= j ) d(i,j) = std::sin( 1.0 + i * 6 + j ) + (i == j ? 3 : 0);
+    }
+    kblas::KMat<double,6,6> full(d);
+    for( int i=0; i<6; ++i ) for( int j=0; j<6; ++j ) if( full(i,j) == 0 ) full(i,j) = 100;   // 反対側は読まれない
+    kblas::KTriMat<double,6,UPLO> t(full);
+    auto dd = t.Dense();
+    for( int i=0; i<6; ++i ) for( int j=0; j<6; ++j ) EXPECT_EQ( d(i,j), dd(i,j) );
+
+    kblas::KVec<double,6> v;
+    kblas::KMat<double,6,3> b;
+    kblas::KMat<double,2,6> c;
+    for( int i=0; i<6; ++i ) {
+        v(i) = std::cos( 0.5 + i );
+        for( int k=0; k<3; ++k ) b(i,k) = std::sin( 2.0 + i * 3 + k );
+        for( int k=0; k<2; ++k ) c(k,i) = std::cos( 1.0 + i * 2 + k );
+    }
+    auto tv = kblas::prod(t, v);
+    auto dv = kblas::prod(d, v);
+    for( int i=0; i<6; ++i ) EXPECT_NEAR( dv(i), tv(i), 1E-14 );
+    auto vt = kblas::prod(v, t);
+    auto vd = kblas::prod(v, d);
+    for( int i=0; i<6; ++i ) EXPECT_NEAR( vd(i), vt(i), 1E-14 );
+    auto tb = kblas::prod(t, b);
+    auto db = kblas::prod(d, b);
+    for( int i=0; i<6; ++i ) for( int k=0; k<3; ++k ) EXPECT_NEAR( db(i,k), tb(i,k), 1E-14 );
+    auto ct = kblas::prod(c, t);
+    auto cd = kblas::prod(c, d);
+    for( int k=0; k<2; ++k ) for( int i=0; i<6; ++i ) EXPECT_NEAR( cd(k,i), ct(k,i), 1E-14 );
+    auto tt = kblas::prod(t, t).Dense();
+    auto ddd = kblas::prod(d, d);
+    for( int i=0; i<6; ++i ) for( int j=0; j<6; ++j ) EXPECT_NEAR( ddd(i,j), tt(i,j), 1E-14 );
+
+    auto tr = t.Trans().Dense();
+    for( int i=0; i<6; ++i ) for( int j=0; j<6; ++j ) EXPECT_EQ( d(j,i), tr(i,j) );
+
+    // 解く
+    kblas::KVec<double,6> x(tv);
+    kblas::trsv<kblas::KNonUnit>( t, x );
+    for( int i=0; i<6; ++i ) EXPECT_NEAR( v(i), x(i), 1E-13 );
+    kblas::KMat<double,6,3> xb(tb);
+    kblas::trsm<kblas::KNonUnit>( t, xb );
+    for( int i=0; i<6; ++i ) for( int k=0; k<3; ++k ) EXPECT_NEAR( b(i,k), xb(i,k), 1E-13 );
+}
+
+TEST( TestTriMat, Test1 ) {
+    const int packed = kblas::KTriMat<float,4,kblas::KLower>::PACKED;
+    EXPECT_EQ( 10, packed );
+    CheckTriMat<kblas::KUpper>();
+    CheckTriMat<kblas::KLower>();
+
+    // const でない行列から読んでも三角部分の外は 0
+    kblas::KTriMat<double,3,kblas::KUpper> u;
+    for( int k=0; k<6; ++k ) u.Data()[k] = k + 1;
+    EXPECT_EQ( 0, u(2,0) );
+    EXPECT_EQ( 0, u(1,0) );
+    EXPECT_EQ( 4, u(1,1) );
+    EXPECT_EQ( 6, u(2,2) );
+    u.Ref(0,2) = 10;
+    u.At<1,2>() = 20;
+    EXPECT_EQ( 10, u(0,2) );
+    EXPECT_EQ( 20, u(1,2) );
+    kblas::KTriMat<double,3,kblas::KLower> l;
+    for( int k=0; k<6; ++k ) l.Data()[k] = k + 1;
+    EXPECT_EQ( 0, l(0,2) );
+    EXPECT_EQ( 4, l(2,0) );
+    EXPECT_EQ( 6, (l.At<2,2>()) );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestBand, Prod ) {
+
+    kblas::KBandMat<double,7,2,1> a(0.0);
+    for( int i=0; i<7; ++i ) for( int j=0; j<7; ++j ) {
+        if( j - i >= -2 && j - i <= 1 ) a.Ref(i,j) = std::sin( 1.0 + i * 7 + j );
+    }
+    kblas::KDiagMat<double,7> w;
+    for( int i=0; i<7; ++i ) w(i) = 0.5 + i;
+    const auto ad = a.Dense();
+    const auto wd = w.Dense();
+
+    kblas::KVec<double,7> v;
+    kblas::KMat<double,7,3> b;
+    kblas::KMat<double,2,7> c;
+    for( int i=0; i<7; ++i ) {
+        v(i) = std::cos( 0.5 + i );
+        for( int k=0; k<3; ++k ) b(i,k) = std::sin( 2.0 + i * 3 + k );
+        for( int k=0; k<2; ++k ) c(k,i) = std::cos( 1.0 + i * 2 + k );
+    }
+    kblas::KMat<double,3,7> bt;
+    for( int i=0; i<7; ++i ) for( int k=0; k<3; ++k ) bt(k,i) = b(i,k);
+
+    // 帯
+    auto r1 = kblas::prod(a, v);
+    auto e1 = kblas::prod(ad, v);
+    for( int i=0; i<7; ++i ) EXPECT_NEAR( e1(i), r1(i), 1E-14 );
+    auto r2 = kblas::prod(v, a);
+    auto e2 = kblas::prod(v, ad);
+    for( int i=0; i<7; ++i ) EXPECT_NEAR( e2(i), r2(i), 1E-14 );
+    auto r3 = kblas::prod(a, b);
+    auto r3t = kblas::prod(a, kblas::trans(bt));
+    auto e3 = kblas::prod(ad, b);
+    for( int i=0; i<7; ++i ) for( int k=0; k<3; ++k ) {
+        EXPECT_NEAR( e3(i,k), r3(i,k), 1E-14 );
+        EXPECT_NEAR( e3(i,k), r3t(i,k), 1E-14 );
+    }
+    auto r4 = kblas::prod(c, a);
+    auto r4t = kblas::prod(kblas::trans(b), a);
+    auto e4 = kblas::prod(c, ad);
+    auto e4t = kblas::prod(bt, ad);
+    for( int i=0; i<7; ++i ) {
+        for( int k=0; k<2; ++k ) EXPECT_NEAR( e4(k,i), r4(k,i), 1E-14 );
+        for( int k=0; k<3; ++k ) EXPECT_NEAR( e4t(k,i), r4t(k,i), 1E-14 );
+    }
+
+    // 対角
+    auto s1 = kblas::prod(w, v);
+    auto s2 = kblas::prod(w, b);
+    auto s3 = kblas::prod(c, w);
+    auto s4 = kblas::prod(kblas::trans(b), w);
+    auto f2 = kblas::prod(wd, b);
+    auto f3 = kblas::prod(c, wd);
+    auto f4 = kblas::prod(bt, wd);
+    for( int i=0; i<7; ++i ) {
+        EXPECT_NEAR( w(i) * v(i), s1(i), 1E-15 );
+        for( int k=0; k<3; ++k ) EXPECT_NEAR( f2(i,k), s2(i,k), 1E-15 );
+        for( int k=0; k<2; ++k ) EXPECT_NEAR( f3(k,i), s3(k,i), 1E-15 );
+        for( int k=0; k<3; ++k ) EXPECT_NEAR( f4(k,i), s4(k,i), 1E-15 );
+    }
+    auto ww = kblas::prod(w, w);
+    EXPECT_NEAR( 6.5 * 6.5, ww(6), 1E-15 );
+
+    // 密な行列に足す
+    kblas::KMat<double,7,7> m(1.0);
+    m += a;
+    m += w;
+    for( int i=0; i<7; ++i ) for( int j=0; j<7; ++j ) EXPECT_NEAR( 1 + ad(i,j) + wd(i,j), m(i,j), 1E-15 );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestSparse, Test1 ) {
+
+    // 等速度モデルの状態遷移 [ 1 0 dt 0 ; 0 1 0 dt ; 0 0 1 0 ; 0 0 0 1 ]
+    // 行ごとのマスク ( i 番目のビット j が (i,j) )
+    typedef kblas::KSparseFixed<double,4,4, 0x5, 0xA, 0x4, 0x8> F;
+    const int nnz = F::NNZ;
+    EXPECT_EQ( 6, nnz );
+
+    F f(1.0);
+    f.At<0,2>() = 0.1;
+    f.Ref(1,3) = 0.1;
+    EXPECT_EQ( 0, f.Dense()(2,0) );
+    EXPECT_EQ( 0.1, f.Dense()(1,3) );
+    const auto fd = f.Dense();
+
+    kblas::KMat<double,4,4> p;
+    for( int i=0; i<4; ++i ) for( int j=0; j<4; ++j ) p(i,j) = std::sin( 1.0 + i * 4 + j );
+    kblas::KVec<double,4> x;
+    for( int i=0; i<4; ++i ) x(i) = std::cos( 0.5 + i );
+
+    auto fx = kblas::prod(f, x);
+    auto fdx = kblas::prod(fd, x);
+    for( int i=0; i<4; ++i ) EXPECT_NEAR( fdx(i), fx(i), 1E-15 );
+
+    // F P F^T
+    auto fpft = kblas::prod( kblas::prod(f, p), f.Trans() );
+    auto ref = kblas::prod( kblas::prod(fd, p), kblas::trans(fd) );
+    for( int i=0; i<4; ++i ) for( int j=0; j<4; ++j ) EXPECT_NEAR( ref(i,j), fpft(i,j), 1E-14 );
+
+    // 長方形のヤコビアン ( 3 x 5 )
+    typedef kblas::KSparseFixed<double,3,5, 0x9, 0x6, 0x10> J;     // (0,0) (0,3) (1,1) (1,2) (2,4)
+    kblas::KMat<double,3,5> jd(0.0);
+    for( int i=0; i<3; ++i ) for( int k=0; k<5; ++k ) if( J::IsNonZero(i,k) ) jd(i,k) = 0.5 + i * 5 + k;
+    J j(jd);
+    const J &cj0 = j;
+    EXPECT_EQ( 14.5, cj0(2,4) );
+    EXPECT_EQ( 0, cj0(2,3) );
+
+    kblas::KMat<double,5,2> b;
+    kblas::KMat<double,2,3> c;
+    kblas::KVec<double,3> v;
+    for( int i=0; i<5; ++i ) for( int k=0; k<2; ++k ) b(i,k) = std::sin( 2.0 + i * 2 + k );
+    for( int i=0; i<2; ++i ) for( int k=0; k<3; ++k ) c(i,k) = std::cos( 1.0 + i * 3 + k );
+    for( int i=0; i<3; ++i ) v(i) = i + 1;
+
+    auto jb = kblas::prod(j, b);
+    auto jdb = kblas::prod(jd, b);
+    for( int i=0; i<3; ++i ) for( int k=0; k<2; ++k ) EXPECT_NEAR( jdb(i,k), jb(i,k), 1E-15 );
+    auto cj = kblas::prod(c, j);
+    auto cjd = kblas::prod(c, jd);
+    for( int i=0; i<2; ++i ) for( int k=0; k<5; ++k ) EXPECT_NEAR( cjd(i,k), cj(i,k), 1E-15 );
+    auto vj = kblas::prod(v, j);
+    auto vjd = kblas::prod(v, jd);
+    for( int k=0; k<5; ++k ) EXPECT_NEAR( vjd(k), vj(k), 1E-15 );
+
+    // 転置のパターン
+    auto jt = j.Trans();
+    const int jtn = decltype(jt)::NNZ;
+    EXPECT_EQ( 5, jtn );
+    auto jtd = jt.Dense();
+    for( int i=0; i<5; ++i ) for( int k=0; k<3; ++k ) EXPECT_EQ( jd(k,i), jtd(i,k) );
+
+    kblas::KMat<double,3,5> acc(1.0);
+    acc += j;
+    EXPECT_EQ( 7.5, acc(1,1) );
+    EXPECT_EQ( 1, acc(2,3) );
+
+    // const でない行列から読んでもパターンの外は 0
+    kblas::KSparseFixed<double,2,2, 0x1, 0x3> s;      // (0,0), (1,0), (1,1)
+    s.At<0,0>() = 7;
+    s.At<1,0>() = 8;
+    s.Ref(1,1) = 9;
+    EXPECT_EQ( 0, s(0,1) );
+    EXPECT_EQ( 8, s(1,0) );
+    EXPECT_EQ( 9, s(1,1) );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TEST( TestSparse, Large ) {
+
+    // 15 状態 ( 位置 5，速度 5，加速度 5 ) の状態遷移．M*N が 64 を超えても使える
+    typedef kblas::KSparseFixed<double,15,15,
+        0x21, 0x42, 0x84, 0x108, 0x210,
+        0x420, 0x840, 0x1080, 0x2100, 0x4200,
+        0x400, 0x800, 0x1000, 0x2000, 0x4000> F;
+    const int nnz = F::NNZ;
+    EXPECT_EQ( 25, nnz );
+
+    F f;
+    for( int i=0; i<15; ++i ) {
+        f.Ref(i,i) = 1;
+        if( i + 5 < 15 ) f.Ref(i,i+5) = 0.1;
+    }
+    EXPECT_EQ( 0.1, (f.At<9,14>()) );
+    EXPECT_EQ( 0, f(14,9) );
+    const auto fd = f.Dense();
+
+    kblas::KMat<double,15,15> p;
+    for( int i=0; i<15; ++i ) for( int j=0; j<15; ++j ) p(i,j) = std::sin( 1.0 + i * 15 + j );
+    kblas::KVec<double,15> x;
+    for( int i=0; i<15; ++i ) x(i) = std::cos( 0.5 + i );
+
+    auto fx = kblas::prod(f, x);
+    auto fdx = kblas::prod(fd, x);
+    for( int i=0; i<15; ++i ) EXPECT_NEAR( fdx(i), fx(i), 1E-15 );
+
+    // F P F^T
+    auto ft = f.Trans();
+    const int ftn = decltype(ft)::NNZ;
+    EXPECT_EQ( 25, ftn );
+    EXPECT_EQ( 0.1, ft(14,9) );
+    EXPECT_EQ( 0, ft(9,14) );
+    auto fpft = kblas::prod( kblas::prod(f, p), ft );
+    auto ref = kblas::prod( kblas::prod(fd, p), kblas::trans(fd) );
+    for( int i=0; i<15; ++i ) for( int j=0; j<15; ++j ) EXPECT_NEAR( ref(i,j), fpft(i,j), 1E-14 );
+}
@@ -0,0 +1,355 @@
+﻿/////////////////////////////////////////////////////////////////////////////
+/** @file
+    @brief  三角行列の前進・後退代入 ( trsv, trsm )
+    @author oniprog
+*/
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "KMat.h"
+
+namespace kblas {
+
+/// 三角行列の上下
+enum KUplo {
+    KLower,
+    KUpper
+};
+
+/// 対角が 1 か
+enum KDiag {
+    KNonUnit,
+    KUnit
+};
+
+namespace Detail {
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 行列を転置して見せる薄いビュー ( 値は写さない )
+    template<class T, class MA>
+    class TransView {
+    public:
+        explicit TransView( const MA &m ) : m_m(m) {}
+
+        const T operator()(int i, int j) const {
+            return m_m(j,i);
+        }
+
+    private:
+        const MA    &m_m;
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 下三角 L に対する前進代入 L y = b ( y は b を上書き )
+    // MA は (i,j) で要素を返すもの ( KMat, KMatTrans, TransView )
+
+    // sum_{0..k} L(i,k) y(k)
+    template<class T, int N, int i, int k>
+    struct LowerDot {
+        template<class MA>
+        static T f( const MA &l, const KVec<T,N> &y ) {
+            return LowerDot<T,N,i,k-1>::f(l, y) + l(i,k) * y(k);
+        }
+    };
+
+    template<class T, int N, int i>
+    struct LowerDot<T,N,i,-1> {
+        template<class MA>
+        static T f( const MA &l, const KVec<T,N> &y ) {
+            return T();
+        }
+    };
+
+    template<class T, int N, int i, bool UNIT>
+    struct LowerSolve {
+        template<class MA>
+        static void f( KVec<T,N> &y, const MA &l ) {
+            LowerSolve<T,N,i-1,UNIT>::f(y, l);
+            y(i) -= LowerDot<T,N,i,i-1>::f(l, y);
+            if( !UNIT ) y(i) /= l(i,i);
+        }
+    };
+
+    template<class T, int N, bool UNIT>
+    struct LowerSolve<T,N,-1,UNIT> {
+        template<class MA>
+        static void f( KVec<T,N> &y, const MA &l ) {
+        }
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 上三角 U に対する後退代入 U x = y ( x は y を上書き )
+
+    // sum_{i+1..k} U(i,k) x(k)
+    template<class T, int N, int i, int k>
+    struct UpperDot {
+        template<class MA>
+        static T f( const MA &u, const KVec<T,N> &x ) {
+            return UpperDot<T,N,i,k-1>::f(u, x) + u(i,k) * x(k);
+        }
+    };
+
+    template<class T, int N, int i>
+    struct UpperDot<T,N,i,i> {
+        template<class MA>
+        static T f( const MA &u, const KVec<T,N> &x ) {
+            return T();
+        }
+    };
+
+    template<class T, int N, int i, bool UNIT>
+    struct UpperSolve {
+        template<class MA>
+        static void f( KVec<T,N> &x, const MA &u ) {
+            x(i) -= UpperDot<T,N,i,N-1>::f(u, x);
+            if( !UNIT ) x(i) /= u(i,i);
+            UpperSolve<T,N,i-1,UNIT>::f(x, u);
+        }
+    };
+
+    template<class T, int N, bool UNIT>
+    struct UpperSolve<T,N,-1,UNIT> {
+        template<class MA>
+        static void f( KVec<T,N> &x, const MA &u ) {
+        }
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 複数右辺 ( 行単位で展開し，右辺の方向は連続なループ )
+
+    // X(i,:) -= A(i,k) X(k,:)
+    template<class T, int N, int K, class MA>
+    inline void TriAxpyRow( KMat<T,N,K> &x, const MA &a, int i, int k ) {
+        const T aik = a(i,k);
+        for( int c=0; c<K; ++c ) x(i,c) -= aik * x(k,c);
+    }
+
+    template<class T, int N, int K, bool UNIT, class MA>
+    inline void TriScaleRow( KMat<T,N,K> &x, const MA &a, int i ) {
+        if( UNIT ) return;
+        const T d = T(1) / a(i,i);
+        for( int c=0; c<K; ++c ) x(i,c) *= d;
+    }
+
+    template<class T, int N, int K, int i, int k>
+    struct LowerRows_2 {
+        template<class MA>
+        static void f( KMat<T,N,K> &x, const MA &l ) {
+            LowerRows_2<T,N,K,i,k-1>::f(x, l);
+            TriAxpyRow( x, l, i, k );
+        }
+    };
+
+    template<class T, int N, int K, int i>
+    struct LowerRows_2<T,N,K,i,-1> {
+        template<class MA>
+        static void f( KMat<T,N,K> &x, const MA &l ) {
+        }
+    };
+
+    template<class T, int N, int K, int i, bool UNIT>
+    struct LowerRows {
+        template<class MA>
+        static void f( KMat<T,N,K> &x, const MA &l ) {
+            LowerRows<T,N,K,i-1,UNIT>::f(x, l);
+            LowerRows_2<T,N,K,i,i-1>::f(x, l);
+            TriScaleRow<T,N,K,UNIT>( x, l, i );
+        }
+    };
+
+    template<class T, int N, int K, bool UNIT>
+    struct LowerRows<T,N,K,-1,UNIT> {
+        template<class MA>
+        static void f( KMat<T,N,K> &x, const MA &l ) {
+        }
+    };
+
+    template<class T, int N, int K, int i, int k>
+    struct UpperRows_2 {
+        template<class MA>
+        static void f( KMat<T,N,K> &x, const MA &u ) {
+            UpperRows_2<T,N,K,i,k-1>::f(x, u);
+            TriAxpyRow( x, u, i, k );
+        }
+    };
+
+    template<class T, int N, int K, int i>
+    struct UpperRows_2<T,N,K,i,i> {
+        template<class MA>
+        static void f( KMat<T,N,K> &x, const MA &u ) {
+        }
+    };
+
+    template<class T, int N, int K, int i, bool UNIT>
+    struct UpperRows {
+        template<class MA>
+        static void f( KMat<T,N,K> &x, const MA &u ) {
+            UpperRows_2<T,N,K,i,N-1>::f(x, u);
+            TriScaleRow<T,N,K,UNIT>( x, u, i );
+            UpperRows<T,N,K,i-1,UNIT>::f(x, u);
+        }
+    };
+
+    template<class T, int N, int K, bool UNIT>
+    struct UpperRows<T,N,K,-1,UNIT> {
+        template<class MA>
+        static void f( KMat<T,N,K> &x, const MA &u ) {
+        }
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 大きな N はブロックに分けたループで解く
+    // 対角ブロックを解いてから，残りの行をそのブロックの解でまとめて更新する
+    // X は (i,c) で要素を返すもの，K は右辺の数
+    static const int TRI_BLOCK = 8;
+
+    template<class T, bool UPPER, bool UNIT, class MA, class MX>
+    void BlockedTriSolve( MX &x, const MA &a, int n, int k ) {
+        if( !UPPER ) {
+            for( int b0=0; b0<n; b0+=TRI_BLOCK ) {
+                const int b1 = b0 + TRI_BLOCK < n ? b0 + TRI_BLOCK : n;
+                for( int i=b0; i<b1; ++i ) {
+                    for( int j=b0; j<i; ++j ) {
+                        const T aij = a(i,j);
+                        for( int c=0; c<k; ++c ) x(i,c) -= aij * x(j,c);
+                    }
+                    if( !UNIT ) {
+                        const T d = T(1) / a(i,i);
+                        for( int c=0; c<k; ++c ) x(i,c) *= d;
+                    }
+                }
+                for( int i=b1; i<n; ++i ) for( int j=b0; j<b1; ++j ) {
+                    const T aij = a(i,j);
+                    for( int c=0; c<k; ++c ) x(i,c) -= aij * x(j,c);
+                }
+            }
+        } else {
+            for( int b1=n; b1>0; b1-=TRI_BLOCK ) {
+                const int b0 = b1 - TRI_BLOCK > 0 ? b1 - TRI_BLOCK : 0;
+                for( int i=b1-1; i>=b0; --i ) {
+                    for( int j=i+1; j<b1; ++j ) {
+                        const T aij = a(i,j);
+                        for( int c=0; c<k; ++c ) x(i,c) -= aij * x(j,c);
+                    }
+                    if( !UNIT ) {
+                        const T d = T(1) / a(i,i);
+                        for( int c=0; c<k; ++c ) x(i,c) *= d;
+                    }
+                }
+                for( int i=0; i<b0; ++i ) for( int j=b0; j<b1; ++j ) {
+                    const T aij = a(i,j);
+                    for( int c=0; c<k; ++c ) x(i,c) -= aij * x(j,c);
+                }
+            }
+        }
+    }
+
+    // KVec を 1 列の行列として見せる
+    template<class T, int N>
+    class VecAsCol {
+    public:
+        explicit VecAsCol( KVec<T,N> &v ) : m_v(v) {}
+
+        T & operator()(int i, int c) const {
+            return m_v(i);
+        }
+
+    private:
+        KVec<T,N>   &m_v;
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // N が小さければ展開，大きければブロック化
+    template<class T, int N, bool UPPER, bool UNIT, bool SMALL>
+    struct TriSolve {
+        template<class MA>
+        static void Vec( KVec<T,N> &x, const MA &a ) {
+            VecAsCol<T,N> xc(x);
+            BlockedTriSolve<T,UPPER,UNIT>( xc, a, N, 1 );
+        }
+        template<int K, class MA>
+        static void Mat( KMat<T,N,K> &x, const MA &a ) {
+            BlockedTriSolve<T,UPPER,UNIT>( x, a, N, K );
+        }
+    };
+
+    template<class T, int N, bool UNIT>
+    struct TriSolve<T,N,false,UNIT,true> {
+        template<class MA>
+        static void Vec( KVec<T,N> &x, const MA &a ) {
+            LowerSolve<T,N,N-1,UNIT>::f(x, a);
+        }
+        template<int K, class MA>
+        static void Mat( KMat<T,N,K> &x, const MA &a ) {
+            LowerRows<T,N,K,N-1,UNIT>::f(x, a);
+        }
+    };
+
+    template<class T, int N, bool UNIT>
+    struct TriSolve<T,N,true,UNIT,true> {
+        template<class MA>
+        static void Vec( KVec<T,N> &x, const MA &a ) {
+            UpperSolve<T,N,N-1,UNIT>::f(x, a);
+        }
+        template<int K, class MA>
+        static void Mat( KMat<T,N,K> &x, const MA &a ) {
+            UpperRows<T,N,K,N-1,UNIT>::f(x, a);
+        }
+    };
+
+    // これより大きい N は展開しない
+    static const int TRI_UNROLL_MAX = 16;
+
+    template<KUplo UPLO, KDiag DIAG, class T, int N>
+    struct Tri : public TriSolve<T,N,(UPLO == KUpper),(DIAG == KUnit),(N <= TRI_UNROLL_MAX)> {
+    };
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// trsv: 三角行列 A で A x = b を解く ( x は b を上書き )
+/// UPLO は A の上下，DIAG が KUnit なら対角を 1 とみなして読まない．反対側の三角は読まない
+/// N <= 16 は展開し，それより大きい N はブロック化したループで解く
+template<KUplo UPLO, KDiag DIAG, class T, int N>
+void trsv( const KMat<T,N,N> &a, KVec<T,N> &x ) {
+    Detail::Tri<UPLO,DIAG,T,N>::Vec(x, a);
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// trsv ( 転置 )．A^T を作らずにそのまま読む．UPLO は転置した後の上下
+template<KUplo UPLO, KDiag DIAG, class T, int N>
+void trsv( const KMatTrans<T,N,N> &a, KVec<T,N> &x ) {
+    Detail::Tri<UPLO,DIAG,T,N>::Vec(x, a);
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// trsm: A X = B を解く ( X は B を上書き )
+template<KUplo UPLO, KDiag DIAG, class T, int N, int K>
+void trsm( const KMat<T,N,N> &a, KMat<T,N,K> &x ) {
+    Detail::Tri<UPLO,DIAG,T,N>::Mat(x, a);
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// trsm ( 転置 )
+template<KUplo UPLO, KDiag DIAG, class T, int N, int K>
+void trsm( const KMatTrans<T,N,N> &a, KMat<T,N,K> &x ) {
+    Detail::Tri<UPLO,DIAG,T,N>::Mat(x, a);
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// trsv_trans: A を転置した A^T x = b を解く ( A はそのまま，UPLO は A の上下 )
+template<KUplo UPLO, KDiag DIAG, class T, int N>
+void trsv_trans( const KMat<T,N,N> &a, KVec<T,N> &x ) {
+    Detail::Tri<(UPLO == KLower ? KUpper : KLower),DIAG,T,N>::Vec(x, Detail::TransView< T,KMat<T,N,N> >(a));
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// trsm_trans: A^T X = B を解く ( A はそのまま，UPLO は A の上下 )
+template<KUplo UPLO, KDiag DIAG, class T, int N, int K>
+void trsm_trans( const KMat<T,N,N> &a, KMat<T,N,K> &x ) {
+    Detail::Tri<(UPLO == KLower ? KUpper : KLower),DIAG,T,N>::Mat(x, Detail::TransView< T,KMat<T,N,N> >(a));
+}
+
+} // namespace kblas
+
+/////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,311 @@
+﻿/////////////////////////////////////////////////////////////////////////////
+/** @file
+    @brief  三角行列 ( 三角部分だけを詰めて持つ ) と 0 を飛ばす積
+    @author oniprog
+*/
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cassert>
+
+#include "KMat.h"
+#include "KMatBlock.h"
+#include "KMatTri.h"
+
+namespace kblas {
+
+// 三角行列
+// T 型
+// N サイズ
+// UPLO KUpper なら上三角 ( i <= j )，KLower なら下三角 ( i >= j )
+// 三角部分を行ごとに詰めて N(N+1)/2 個だけ持つ
+template<class T, int N, KUplo UPLO>
+class KTriMat {
+public:
+    static const int SIZE = N;
+    static const int PACKED = N * (N + 1) / 2;
+    static const KUplo UPLO_TYPE = UPLO;
+public:
+
+    KTriMat() {}
+
+    /// 三角部分の要素をすべて v にする
+    KTriMat( const T &v ) {
+        for( int k=0; k<PACKED; ++k ) m_v[k] = v;
+    }
+
+    /// KMat の三角部分から作る ( 反対側は見ない )
+    explicit KTriMat( const KMat<T,N,N> &m ) {
+        for( int i=0; i<N; ++i ) {
+            const int j0 = UPLO == KUpper ? i : 0;
+            const int j1 = UPLO == KUpper ? N-1 : i;
+            for( int j=j0; j<=j1; ++j ) m_v[Index(i,j)] = m(i,j);
+        }
+    }
+
+    /// 三角部分の外は 0
+    const T operator()(int i, int j) const {
+        return IsInside(i,j) ? m_v[Index(i,j)] : T();
+    }
+
+    /// 書き込み用．(i,j) は三角部分の中であること
+    T & Ref( int i, int j ) {
+        assert( IsInside(i,j) );
+        return m_v[Index(i,j)];
+    }
+
+    /// コンパイル時に位置を決めて読み書きする
+    template<int i, int j>
+    T & At() {
+        static_assert( i >= 0 && i < N && j >= 0 && j < N, "At: out of range" );
+        static_assert( UPLO == KUpper ? i <= j : i >= j, "At: outside the triangle" );
+        return m_v[UPLO == KUpper ? i * N - i * (i - 1) / 2 + (j - i) : i * (i + 1) / 2 + j];
+    }
+    template<int i, int j>
+    const T At() const {
+        static_assert( i >= 0 && i < N && j >= 0 && j < N, "At: out of range" );
+        static_assert( UPLO == KUpper ? i <= j : i >= j, "At: outside the triangle" );
+        return m_v[UPLO == KUpper ? i * N - i * (i - 1) / 2 + (j - i) : i * (i + 1) / 2 + j];
+    }
+
+    /// 詰めた並び
+    T * Data() {
+        return m_v;
+    }
+    const T * Data() const {
+        return m_v;
+    }
+
+    /// 密な行列にする
+    KMat<T,N,N> Dense() const {
+        KMat<T,N,N> m;
+        for( int i=0; i<N; ++i ) for( int j=0; j<N; ++j ) m(i,j) = (*this)(i,j);
+        return m;
+    }
+
+    /// 転置 ( 上下が入れ替わる )
+    KTriMat<T,N,(UPLO == KUpper ? KLower : KUpper)> Trans() const {
+        KTriMat<T,N,(UPLO == KUpper ? KLower : KUpper)> r;
+        for( int i=0; i<N; ++i ) for( int j=0; j<N; ++j ) {
+            if( IsInside(i,j) ) r.Ref(j,i) = m_v[Index(i,j)];
+        }
+        return r;
+    }
+
+    static bool IsInside( int i, int j ) {
+        return UPLO == KUpper ? i <= j : i >= j;
+    }
+
+    /// 三角部分 (i,j) の詰めた位置
+    static int Index( int i, int j ) {
+        return UPLO == KUpper ? i * N - i * (i - 1) / 2 + (j - i) : i * (i + 1) / 2 + j;
+    }
+
+private:
+    T   m_v[PACKED];
+};
+
+namespace Detail {
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 三角行列の i 行目 / j 列目で 0 でない範囲 ( K0 から C 個 )
+    template<int N, KUplo UPLO, int i>
+    struct TriRowRange {
+        static const int K0 = UPLO == KUpper ? i : 0;
+        static const int C = UPLO == KUpper ? N - i : i + 1;
+    };
+
+    template<int N, KUplo UPLO, int j>
+    struct TriColRange {
+        static const int K0 = UPLO == KUpper ? 0 : j;
+        static const int C = UPLO == KUpper ? j + 1 : N - j;
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // sum_{k=K0}^{K0+C-1} a(i,k) b(k,j) ( 範囲の外は展開しない )
+    template<class T, int i, int j, int K0, int C>
+    struct TriDot {
+        template<class MA, class MB>
+        static T f( const MA &a, const MB &b ) {
+            return TriDot<T,i,j,K0,C-1>::f(a, b) + a(i,K0+C-1) * b(K0+C-1,j);
+        }
+    };
+
+    template<class T, int i, int j, int K0>
+    struct TriDot<T,i,j,K0,0> {
+        template<class MA, class MB>
+        static T f( const MA &a, const MB &b ) {
+            return T();
+        }
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 三角 x 密 ( N x N と N x K )
+    template<class T, int N, KUplo UPLO, int i, int j>
+    struct TriLeftRow {
+        template<class MR, class MA, class MB>
+        static void f( MR &r, const MA &a, const MB &b ) {
+            r(i,j) = TriDot<T,i,j,TriRowRange<N,UPLO,i>::K0,TriRowRange<N,UPLO,i>::C>::f(a, b);
+            TriLeftRow<T,N,UPLO,i,j-1>::f(r, a, b);
+        }
+    };
+
+    template<class T, int N, KUplo UPLO, int i>
+    struct TriLeftRow<T,N,UPLO,i,-1> {
+        template<class MR, class MA, class MB>
+        static void f( MR &r, const MA &a, const MB &b ) {
+        }
+    };
+
+    template<class T, int N, int K, KUplo UPLO, int i>
+    struct TriLeft {
+        template<class MR, class MA, class MB>
+        static void f( MR &r, const MA &a, const MB &b ) {
+            TriLeftRow<T,N,UPLO,i,K-1>::f(r, a, b);
+            TriLeft<T,N,K,UPLO,i-1>::f(r, a, b);
+        }
+    };
+
+    template<class T, int N, int K, KUplo UPLO>
+    struct TriLeft<T,N,K,UPLO,-1> {
+        template<class MR, class MA, class MB>
+        static void f( MR &r, const MA &a, const MB &b ) {
+        }
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 密 x 三角 ( M x N と N x N )
+    template<class T, int N, KUplo UPLO, int i, int j>
+    struct TriRightRow {
+        template<class MR, class MB, class MA>
+        static void f( MR &r, const MB &b, const MA &a ) {
+            r(i,j) = TriDot<T,i,j,TriColRange<N,UPLO,j>::K0,TriColRange<N,UPLO,j>::C>::f(b, a);
+            TriRightRow<T,N,UPLO,i,j-1>::f(r, b, a);
+        }
+    };
+
+    template<class T, int N, KUplo UPLO, int i>
+    struct TriRightRow<T,N,UPLO,i,-1> {
+        template<class MR, class MB, class MA>
+        static void f( MR &r, const MB &b, const MA &a ) {
+        }
+    };
+
+    template<class T, int N, KUplo UPLO, int i>
+    struct TriRight {
+        template<class MR, class MB, class MA>
+        static void f( MR &r, const MB &b, const MA &a ) {
+            TriRightRow<T,N,UPLO,i,N-1>::f(r, b, a);
+            TriRight<T,N,UPLO,i-1>::f(r, b, a);
+        }
+    };
+
+    template<class T, int N, KUplo UPLO>
+    struct TriRight<T,N,UPLO,-1> {
+        template<class MR, class MB, class MA>
+        static void f( MR &r, const MB &b, const MA &a ) {
+        }
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // 三角 x 三角 ( 同じ向き ) の i 行目．結果も三角なので三角部分だけを c 個求める
+    //   KUpper: (i,j) は k = i..j, KLower: (i,j) は k = j..i
+    template<class T, int N, KUplo UPLO, int i, int c>
+    struct TriTriRow {
+        static const int J = UPLO == KUpper ? i + c - 1 : c - 1;
+        template<class MR, class MA, class MB>
+        static void f( MR &r, const MA &a, const MB &b ) {
+            r.template At<i,J>() = TriDot<T,i,J,(UPLO == KUpper ? i : J),(UPLO == KUpper ? J - i + 1 : i - J + 1)>::f(a, b);
+            TriTriRow<T,N,UPLO,i,c-1>::f(r, a, b);
+        }
+    };
+
+    template<class T, int N, KUplo UPLO, int i>
+    struct TriTriRow<T,N,UPLO,i,0> {
+        template<class MR, class MA, class MB>
+        static void f( MR &r, const MA &a, const MB &b ) {
+        }
+    };
+
+    template<class T, int N, KUplo UPLO, int i>
+    struct TriTri {
+        template<class MR, class MA, class MB>
+        static void f( MR &r, const MA &a, const MB &b ) {
+            TriTriRow<T,N,UPLO,i,TriRowRange<N,UPLO,i>::C>::f(r, a, b);
+            TriTri<T,N,UPLO,i-1>::f(r, a, b);
+        }
+    };
+
+    template<class T, int N, KUplo UPLO>
+    struct TriTri<T,N,UPLO,-1> {
+        template<class MR, class MA, class MB>
+        static void f( MR &r, const MA &a, const MB &b ) {
+        }
+    };
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 三角 x ベクトル ( 0 の半分は展開しないので，密な積のおよそ半分の演算 )
+template<class T, int N, KUplo UPLO>
+KVec<T,N> prod( const KTriMat<T,N,UPLO> &a, const KVec<T,N> &v ) {
+    KVec<T,N> r;
+    Detail::ColOf< T,KVec<T,N> > rc(r);
+    Detail::TriLeft<T,N,1,UPLO,N-1>::f(rc, a, Detail::ConstColOf< T,KVec<T,N> >(v));
+    return r;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// ベクトル x 三角 ( v^T A )
+template<class T, int N, KUplo UPLO>
+KVec<T,N> prod( const KVec<T,N> &v, const KTriMat<T,N,UPLO> &a ) {
+    KVec<T,N> r;
+    Detail::RowOf< T,KVec<T,N> > rr(r);
+    Detail::TriRight<T,N,UPLO,0>::f(rr, Detail::ConstRowOf< T,KVec<T,N> >(v), a);
+    return r;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 三角 x 密
+template<class T, int N, int K, KUplo UPLO>
+KMat<T,N,K> prod( const KTriMat<T,N,UPLO> &a, const KMat<T,N,K> &b ) {
+    KMat<T,N,K> r;
+    Detail::TriLeft<T,N,K,UPLO,N-1>::f(r, a, b);
+    return r;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 密 x 三角
+template<class T, int M, int N, KUplo UPLO>
+KMat<T,M,N> prod( const KMat<T,M,N> &b, const KTriMat<T,N,UPLO> &a ) {
+    KMat<T,M,N> r;
+    Detail::TriRight<T,N,UPLO,M-1>::f(r, b, a);
+    return r;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// 三角 x 三角 ( 同じ向きなら結果も三角 )
+template<class T, int N, KUplo UPLO>
+KTriMat<T,N,UPLO> prod( const KTriMat<T,N,UPLO> &a, const KTriMat<T,N,UPLO> &b ) {
+    KTriMat<T,N,UPLO> r;
+    Detail::TriTri<T,N,UPLO,N-1>::f(r, a, b);
+    return r;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// A x = b を解く ( x は b を上書き．三角部分だけを読む )
+template<KDiag DIAG, class T, int N, KUplo UPLO>
+void trsv( const KTriMat<T,N,UPLO> &a, KVec<T,N> &x ) {
+    Detail::Tri<UPLO,DIAG,T,N>::Vec(x, a);
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// A X = B を解く ( X は B を上書き )
+template<KDiag DIAG, class T, int N, int K, KUplo UPLO>
+void trsm( const KTriMat<T,N,UPLO> &a, KMat<T,N,K> &x ) {
+    Detail::Tri<UPLO,DIAG,T,N>::Mat(x, a);
+}
+
+} // namespace kblas
+
+/////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,136 @@
+﻿/////////////////////////////////////////////////////////////////////////////
+/** @file
+    @brief  逆行列の低ランク更新 ( Sherman-Morrison, Woodbury )
+    @author oniprog
+*/
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cmath>
+#include <limits>
+
+#include "KMat.h"
+#include "KMatInv.h"
+#include "KMatLU.h"
+
+namespace kblas {
+
+namespace Detail {
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // X = Ainv U, Y = V^T Ainv を Ainv を 1 回なめるだけで求める
+    template<class T, int N, int K>
+    void FusedSides( const KMat<T,N,N> &ainv, const KMat<T,N,K> &u, const KMat<T,N,K> &v,
+                     KMat<T,N,K> &x, KMat<T,K,N> &y ) {
+        y = KMat<T,K,N>(T(0));
+        for( int i=0; i<N; ++i ) {
+            T xi[K];
+            for( int k=0; k<K; ++k ) xi[k] = T();
+            for( int j=0; j<N; ++j ) {
+                const T aij = ainv(i,j);
+                for( int k=0; k<K; ++k ) {
+                    xi[k] += aij * u(j,k);
+                    y(k,j) += v(i,k) * aij;
+                }
+            }
+            for( int k=0; k<K; ++k ) x(i,k) = xi[k];
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // K x K の容量行列 S = I + V^T Ainv U で Z = S^{-1} Y を求める
+    // |det S| が mag ( 行列式の上界 ) の tol 倍以下なら特異とみなして false を返す
+    // K <= 4 は閉じた式，それ以上は LU
+    template<class T, int K, int N, bool SMALL>
+    struct CapacitySolve {
+        static bool f( const KMat<T,K,K> &s, const KMat<T,K,N> &y, KMat<T,K,N> &z, const T &mag, const T &tol ) {
+            const KLU<T,K> f(s);
+            if( !f.IsOk() || std::abs(f.Det()) <= tol * mag ) return false;
+            z = f.Solve(y);
+            return true;
+        }
+    };
+
+    template<class T, int K, int N>
+    struct CapacitySolve<T,K,N,true> {
+        static bool f( const KMat<T,K,K> &s, const KMat<T,K,N> &y, KMat<T,K,N> &z, const T &mag, const T &tol ) {
+            KMat<T,K,K> si;
+            const T d = InvKMat<T,K>::f(s, si);
+            if( !(std::abs(d) > tol * mag) ) return false;
+            z = prod(si, y);
+            return true;
+        }
+    };
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// Sherman-Morrison: Ainv = A^{-1} を (A + u v^T)^{-1} に置き換える ( O(N^2) )
+/// Ainv u と v^T Ainv は 1 回のループでまとめて求める
+/// 1 + v^T Ainv u が ( 1 + |v|・|Ainv u| ) の tol 倍以下なら更新後が特異とみなし，Ainv には触らずに false を返す
+template<class T, int N>
+bool inverse_rank1_update( KMat<T,N,N> &ainv, const KVec<T,N> &u, const KVec<T,N> &v,
+                           const T &tol = N * std::numeric_limits<T>::epsilon() ) {
+    KMat<T,N,1> uu, vv, x;
+    KMat<T,1,N> y;
+    for( int i=0; i<N; ++i ) {
+        uu(i,0) = u(i);
+        vv(i,0) = v(i);
+    }
+    Detail::FusedSides( ainv, uu, vv, x, y );
+
+    T den = T(1), mag = T(1);
+    for( int i=0; i<N; ++i ) {
+        den += v(i) * x(i,0);
+        mag += std::abs(v(i) * x(i,0));
+    }
+    if( std::abs(den) <= tol * mag ) return false;
+
+    const T inv = T(1) / den;
+    for( int i=0; i<N; ++i ) {
+        const T xi = x(i,0) * inv;
+        for( int j=0; j<N; ++j ) ainv(i,j) -= xi * y(0,j);
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+/// Woodbury: Ainv = A^{-1} を (A + U V^T)^{-1} に置き換える ( U, V は N x K, O(N^2 K) )
+/// (A + U V^T)^{-1} = Ainv - Ainv U (I + V^T Ainv U)^{-1} V^T Ainv
+/// S = I + V^T Ainv U の行列式が，各行の和 sum_b ( d_ab + sum_i |v_ia (Ainv U)_ib| ) の積の tol 倍以下なら
+/// 更新後が特異とみなし，Ainv には触らずに false を返す ( K = 1 では inverse_rank1_update と同じ判定 )
+template<class T, int N, int K>
+bool inverse_rank_update( KMat<T,N,N> &ainv, const KMat<T,N,K> &u, const KMat<T,N,K> &v,
+                          const T &tol = N * std::numeric_limits<T>::epsilon() ) {
+    KMat<T,N,K> x;
+    KMat<T,K,N> y;
+    Detail::FusedSides( ainv, u, v, x, y );
+
+    // S = I + V^T X と，その行ごとの絶対値の和
+    KMat<T,K,K> s(T(0));
+    T rows[K];
+    for( int a=0; a<K; ++a ) rows[a] = T(1);
+    for( int i=0; i<N; ++i ) for( int a=0; a<K; ++a ) {
+        const T via = v(i,a);
+        for( int b=0; b<K; ++b ) {
+            s(a,b) += via * x(i,b);
+            rows[a] += std::abs(via * x(i,b));
+        }
+    }
+    for( int a=0; a<K; ++a ) s(a,a) += T(1);
+    T mag = T(1);
+    for( int a=0; a<K; ++a ) mag *= rows[a];
+
+    KMat<T,K,N> z;
+    if( !Detail::CapacitySolve<T,K,N,(K <= 4)>::f(s, y, z, mag, tol) ) return false;
+
+    for( int i=0; i<N; ++i ) for( int k=0; k<K; ++k ) {
+        const T xik = x(i,k);
+        for( int j=0; j<N; ++j ) ainv(i,j) -= xik * z(k,j);
+    }
+    return true;
+}
+
+} // namespace kblas
+
+/////////////////////////////////////////////////////////////////////////////